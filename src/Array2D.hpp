@@ -2,67 +2,785 @@
 #define ARRAY2D_HPP
 
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <algorithm>
+#include <iterator>
 #include <iostream>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
+/*!
+ * @brief Non-owning view of a two-dimensional array
+ *
+ * Element (y, x) is data[y * rowStride + x * colStride], so that
+ * a view can refer to a tile or every n-th row/column of an array
+ * without copying.
+ */
 template<typename ElmType>
-class Array2D {
+class Array2DView {
 public:
   typedef std::size_t size_type;
 private:
+  ElmType* data;
   size_type nRow;
   size_type nCol;
-#if __cplusplus >= 201103L
-  std::unique_ptr<ElmType[]> data;
-#else
+  size_type rowStride;
+  size_type colStride;
+public:
+  Array2DView(ElmType* data, size_type nRow, size_type nCol, size_type rowStride, size_type colStride = 1) noexcept :
+    data(data),
+    nRow(nRow),
+    nCol(nCol),
+    rowStride(rowStride),
+    colStride(colStride)
+  {}
+
+  ElmType&
+  at(size_type y, size_type x) const noexcept
+  {
+    assert(y < nRow && x < nCol);
+    return data[y * rowStride + x * colStride];
+  }
+
+  /*!
+   * @brief Get pointer to the specified row (only for views whose column stride is 1)
+   */
+  ElmType*
+  operator[](size_type y) const noexcept
+  {
+    assert(colStride == 1);
+    return &data[y * rowStride];
+  }
+
+  /*!
+   * @brief Get view of sub-array
+   * @param [in] y        First row
+   * @param [in] x        First column
+   * @param [in] nRow     Number of rows of sub-array
+   * @param [in] nCol     Number of columns of sub-array
+   * @param [in] rowStep  Take every rowStep-th row
+   * @param [in] colStep  Take every colStep-th column
+   * @return View of sub-array
+   */
+  Array2DView<ElmType>
+  subView(size_type y, size_type x, size_type nRow, size_type nCol, size_type rowStep = 1, size_type colStep = 1) const noexcept
+  {
+    assert(rowStep > 0 && colStep > 0);
+    assert(nRow == 0 || y + (nRow - 1) * rowStep < this->nRow);
+    assert(nCol == 0 || x + (nCol - 1) * colStep < this->nCol);
+    return Array2DView<ElmType>(data + y * rowStride + x * colStride, nRow, nCol, rowStride * rowStep, colStride * colStep);
+  }
+
+  void
+  fill(const ElmType& value) const
+  {
+    for (size_type i = 0; i < nRow; i++) {
+      for (size_type j = 0; j < nCol; j++) {
+        at(i, j) = value;
+      }
+    }
+  }
+
+  ElmType*
+  getData() const noexcept
+  {
+    return data;
+  }
+
+  size_type
+  getNRow() const noexcept
+  {
+    return nRow;
+  }
+
+  size_type
+  getNCol() const noexcept
+  {
+    return nCol;
+  }
+
+  size_type
+  getRowStride() const noexcept
+  {
+    return rowStride;
+  }
+
+  size_type
+  getColStride() const noexcept
+  {
+    return colStride;
+  }
+};  // class Array2DView
+
+
+/*!
+ * @brief Row-major layout of Array2D, each row occupies pitch elements
+ */
+class RowMajorLayout {
+public:
+  typedef std::size_t size_type;
+
+  static constexpr bool kIsRowMajor = true;
+
+  RowMajorLayout(size_type nRow = 0, size_type nCol = 0, size_type nPitch = 0) noexcept :
+    nRow(nRow),
+    nPitch(std::max(nCol, nPitch))
+  {}
+
+  //! Number of elements to allocate
+  size_type
+  capacity() const noexcept
+  {
+    return nRow * nPitch;
+  }
+
+  size_type
+  index(size_type y, size_type x) const noexcept
+  {
+    return y * nPitch + x;
+  }
+
+  //! Inverse of index(); positions in padding are out of the array
+  void
+  position(size_type k, size_type& y, size_type& x) const noexcept
+  {
+    y = k / nPitch;
+    x = k % nPitch;
+  }
+
+  //! Move (k, y, x) to the next element of a nRow x nCol array in storage order, or k to capacity()
+  void
+  advance(size_type& k, size_type& y, size_type& x, size_type, size_type nCol) const noexcept
+  {
+    k++;
+    if (++x < nCol) {
+      return;
+    }
+    k += nPitch - nCol;
+    x = 0;
+    y++;
+  }
+
+  size_type
+  getPitch() const noexcept
+  {
+    return nPitch;
+  }
+
+private:
+  size_type nRow;
+  size_type nPitch;
+};  // class RowMajorLayout
+
+
+/*!
+ * @brief Tiled layout of Array2D
+ *
+ * The array is divided into square tiles of 2 ** kTileShift elements
+ * on a side; tiles are placed in row-major order and each tile is stored
+ * contiguously in row-major order, so that vertical neighbours are
+ * usually in the same few cache lines.
+ *
+ * @tparam kTileShift  Base 2 logarithm of the tile width
+ */
+template<unsigned int kTileShift = 3>
+class TiledLayout {
+public:
+  typedef std::size_t size_type;
+
+  static constexpr bool kIsRowMajor = false;
+  static constexpr size_type kTileWidth = size_type(1) << kTileShift;
+  static constexpr size_type kTileMask = kTileWidth - 1;
+
+  TiledLayout(size_type nRow = 0, size_type nCol = 0, size_type = 0) noexcept :
+    nTileRow((nRow + kTileMask) >> kTileShift),
+    nTileCol((nCol + kTileMask) >> kTileShift)
+  {}
+
+  size_type
+  capacity() const noexcept
+  {
+    return (nTileRow * nTileCol) << (2 * kTileShift);
+  }
+
+  size_type
+  index(size_type y, size_type x) const noexcept
+  {
+    return ((((y >> kTileShift) * nTileCol + (x >> kTileShift)) << (2 * kTileShift))
+      | ((y & kTileMask) << kTileShift)
+      | (x & kTileMask));
+  }
+
+  void
+  position(size_type k, size_type& y, size_type& x) const noexcept
+  {
+    const auto tile = k >> (2 * kTileShift);
+    y = ((tile / nTileCol) << kTileShift) | ((k >> kTileShift) & kTileMask);
+    x = ((tile % nTileCol) << kTileShift) | (k & kTileMask);
+  }
+
+  //! Elements within a tile are decoded by bit operations, and the tile origin is carried over
+  void
+  advance(size_type& k, size_type& y, size_type& x, size_type nRow, size_type nCol) const noexcept
+  {
+    static constexpr size_type kTileSizeMask = (size_type(1) << (2 * kTileShift)) - 1;
+    const auto n = capacity();
+    for (;;) {
+      auto y0 = y & ~kTileMask;
+      auto x0 = x & ~kTileMask;
+      if ((++k & kTileSizeMask) == 0) {
+        if (k == n) {
+          return;
+        }
+        x0 += kTileWidth;
+        if (x0 >= nCol) {
+          x0 = 0;
+          y0 += kTileWidth;
+        }
+      }
+      y = y0 | ((k >> kTileShift) & kTileMask);
+      x = x0 | (k & kTileMask);
+      if (y < nRow && x < nCol) {
+        return;
+      }
+    }
+  }
+
+private:
+  size_type nTileRow;
+  size_type nTileCol;
+};  // class TiledLayout
+
+template<unsigned int kTileShift>
+constexpr bool TiledLayout<kTileShift>::kIsRowMajor;
+template<unsigned int kTileShift>
+constexpr typename TiledLayout<kTileShift>::size_type TiledLayout<kTileShift>::kTileWidth;
+template<unsigned int kTileShift>
+constexpr typename TiledLayout<kTileShift>::size_type TiledLayout<kTileShift>::kTileMask;
+
+
+/*!
+ * @brief Z-order (Morton order) layout of Array2D
+ *
+ * Bits of y and x are interleaved for the lower min(log2(H), log2(W)) bits,
+ * and the rest of the bits of the longer side are placed above them.
+ * Each side is rounded up to a power of two, so up to four times as many
+ * elements as the array may be allocated.
+ */
+class MortonLayout {
+public:
+  typedef std::size_t size_type;
+
+  static constexpr bool kIsRowMajor = false;
+
+  MortonLayout(size_type nRow = 0, size_type nCol = 0, size_type = 0) noexcept :
+    yBits(ceilLog2(nRow)),
+    xBits(ceilLog2(nCol)),
+    nBits(std::min(yBits, xBits))
+  {}
+
+  size_type
+  capacity() const noexcept
+  {
+    return size_type(1) << (yBits + xBits);
+  }
+
+  size_type
+  index(size_type y, size_type x) const noexcept
+  {
+    const auto mask = (size_type(1) << nBits) - 1;
+    return (((y >> nBits) | (x >> nBits)) << (2 * nBits)) | (spread(y & mask) << 1) | spread(x & mask);
+  }
+
+  void
+  position(size_type k, size_type& y, size_type& x) const noexcept
+  {
+    const auto mask = (size_type(1) << (2 * nBits)) - 1;
+    const auto high = k >> (2 * nBits);
+    y = compact((k & mask) >> 1);
+    x = compact(k & mask);
+    if (yBits > xBits) {
+      y |= high << nBits;
+    } else {
+      x |= high << nBits;
+    }
+  }
+
+  //! Decoding is a few bit operations, so padding is skipped by position()
+  void
+  advance(size_type& k, size_type& y, size_type& x, size_type nRow, size_type nCol) const noexcept
+  {
+    for (const auto n = capacity(); ++k < n;) {
+      position(k, y, x);
+      if (y < nRow && x < nCol) {
+        return;
+      }
+    }
+  }
+
+private:
+  static unsigned int
+  ceilLog2(size_type n) noexcept
+  {
+    unsigned int b = 0;
+    for (; (size_type(1) << b) < n; b++);
+    return b;
+  }
+
+  //! Insert a zero bit above each of the lower 32 bits
+  static size_type
+  spread(size_type v) noexcept
+  {
+    std::uint64_t w = v;
+    w = (w | (w << 16)) & 0x0000ffff0000ffffULL;
+    w = (w | (w << 8)) & 0x00ff00ff00ff00ffULL;
+    w = (w | (w << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    w = (w | (w << 2)) & 0x3333333333333333ULL;
+    w = (w | (w << 1)) & 0x5555555555555555ULL;
+    return static_cast<size_type>(w);
+  }
+
+  //! Inverse of spread(), gather even bits
+  static size_type
+  compact(size_type v) noexcept
+  {
+    std::uint64_t w = v & 0x5555555555555555ULL;
+    w = (w | (w >> 1)) & 0x3333333333333333ULL;
+    w = (w | (w >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+    w = (w | (w >> 4)) & 0x00ff00ff00ff00ffULL;
+    w = (w | (w >> 8)) & 0x0000ffff0000ffffULL;
+    w = (w | (w >> 16)) & 0x00000000ffffffffULL;
+    return static_cast<size_type>(w);
+  }
+
+  unsigned int yBits;
+  unsigned int xBits;
+  unsigned int nBits;
+};  // class MortonLayout
+
+
+/*!
+ * @brief Iterator which visits elements of Array2D in the order of storage
+ *
+ * Padding elements of the layout are skipped.
+ * getY() and getX() give the position of the current element; they are
+ * decoded by Layout::position() only for the first element and advanced
+ * incrementally by Layout::advance() after that.
+ */
+template<
+  typename ElmType,
+  typename Layout
+>
+class Array2DLayoutIterator {
+public:
+  typedef std::size_t size_type;
+  typedef std::forward_iterator_tag iterator_category;
+  typedef ElmType value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef ElmType* pointer;
+  typedef ElmType& reference;
+
+  Array2DLayoutIterator(ElmType* data, const Layout* layout, size_type nRow, size_type nCol, size_type k) noexcept :
+    data(data),
+    layout(layout),
+    nRow(nRow),
+    nCol(nCol),
+    k(k),
+    y(0),
+    x(0)
+  {
+    skip();
+  }
+
+  reference
+  operator*() const noexcept
+  {
+    return data[k];
+  }
+
+  pointer
+  operator->() const noexcept
+  {
+    return data + k;
+  }
+
+  Array2DLayoutIterator&
+  operator++() noexcept
+  {
+    layout->advance(k, y, x, nRow, nCol);
+    return *this;
+  }
+
+  Array2DLayoutIterator
+  operator++(int) noexcept
+  {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  size_type
+  getY() const noexcept
+  {
+    return y;
+  }
+
+  size_type
+  getX() const noexcept
+  {
+    return x;
+  }
+
+  bool
+  operator==(const Array2DLayoutIterator& that) const noexcept
+  {
+    return k == that.k;
+  }
+
+  bool
+  operator!=(const Array2DLayoutIterator& that) const noexcept
+  {
+    return k != that.k;
+  }
+
+private:
+  void
+  skip() noexcept
+  {
+    const auto n = layout->capacity();
+    for (; k < n; k++) {
+      layout->position(k, y, x);
+      if (y < nRow && x < nCol) {
+        return;
+      }
+    }
+    k = n;
+  }
+
   ElmType* data;
-#endif
+  const Layout* layout;
+  size_type nRow;
+  size_type nCol;
+  size_type k;
+  size_type y;
+  size_type x;
+};  // class Array2DLayoutIterator
+
+
+/*!
+ * @brief Two-dimensional array
+ *
+ * The buffer is aligned to kAlignment bytes. With RowMajorLayout each row occupies nPitch
+ * elements (nPitch >= nCol); padding elements are allocated but not part
+ * of the array.
+ * recommendedPitch() gives a pitch which keeps every row aligned and whose
+ * size in bytes has no power-of-two factor of 512 or more, which would map
+ * a column to a few cache sets.
+ *
+ * The storage order is given by Layout (RowMajorLayout, TiledLayout or
+ * MortonLayout); at(y, x) and iteration in storage order work with any
+ * layout, while row pointers, pitch and views need RowMajorLayout.
+ */
+template<
+  typename ElmType,
+  typename Layout = RowMajorLayout
+>
+class Array2D {
+public:
+  typedef std::size_t size_type;
+  typedef Array2DLayoutIterator<ElmType, Layout> iterator;
+
+  //! Alignment of the buffer in bytes
+  static constexpr size_type kAlignment = alignof(ElmType) > 64 ? alignof(ElmType) : 64;
+
+  /*!
+   * @brief Calculate a row pitch suitable for SIMD access
+   *
+   * The pitch is rounded up to a multiple of kAlignment bytes when possible,
+   * and one more alignment unit is added if a row is a multiple of
+   * 8 * kAlignment bytes (512 bytes), so that a column walk visits all cache
+   * sets instead of a few.
+   *
+   * @param [in] nCol  Number of columns
+   * @return Row pitch in elements
+   */
+  static size_type
+  recommendedPitch(size_type nCol) noexcept
+  {
+    if (kAlignment % sizeof(ElmType) != 0) {
+      return nCol;
+    }
+    const auto unit = kAlignment / sizeof(ElmType);
+    auto pitch = (nCol + unit - 1) / unit * unit;
+    if (pitch != 0 && pitch / unit % 8 == 0) {
+      pitch += unit;
+    }
+    return pitch;
+  }
+
+private:
+  /*!
+   * @brief Type-erased release function of an adopted buffer
+   */
+  struct Releaser
+  {
+    virtual
+    ~Releaser()
+    {}
+
+    virtual void
+    release(ElmType* p) noexcept = 0;
+  };  // struct Releaser
+
+  template<typename Deleter>
+  struct ReleaserImpl :
+    public Releaser
+  {
+    explicit ReleaserImpl(Deleter deleter_) :
+      deleter(std::move(deleter_))
+    {}
+
+    void
+    release(ElmType* p) noexcept override
+    {
+      deleter(p);
+    }
+
+    Deleter deleter;
+  };  // struct ReleaserImpl
+
+  /*!
+   * @brief Holder which releases an adopted std::vector with itself
+   */
+  struct VectorReleaser
+  {
+    void
+    operator()(ElmType*) const noexcept
+    {}
+
+    std::vector<ElmType> vec;
+  };  // struct VectorReleaser
+
+  /*!
+   * @brief Deleter which destructs elements and releases over-allocated memory
+   *
+   * For an adopted buffer, n is kAdopted and base points to a Releaser,
+   * so that owned arrays do not pay for type erasure.
+   */
+  struct AlignedDeleter
+  {
+    static constexpr size_type kAdopted = ~size_type(0);
+
+    AlignedDeleter(void* base_ = nullptr, size_type n_ = 0) noexcept :
+      base(base_),
+      n(n_)
+    {}
+
+    void
+    operator()(ElmType* p) const noexcept
+    {
+      if (n == kAdopted) {
+        const auto releaser = static_cast<Releaser*>(base);
+        releaser->release(p);
+        delete releaser;
+        return;
+      }
+      for (size_type i = 0; i < n; i++) {
+        p[i].~ElmType();
+      }
+      ::operator delete(base);
+    }
+
+    //! Pointer returned by operator new, or Releaser of an adopted buffer
+    void* base;
+    //! Number of constructed elements, or kAdopted
+    size_type n;
+  };  // struct AlignedDeleter
+
+  typedef std::unique_ptr<ElmType, AlignedDeleter> pointer_type;
+
+  size_type nRow;
+  size_type nCol;
+  Layout layout;
+  pointer_type data;
 
+  static pointer_type
+  allocate(size_type n)
+  {
+    if (n == 0) {
+      return pointer_type();
+    }
+    const auto base = ::operator new(n * sizeof(ElmType) + kAlignment - 1);
+    const auto addr = reinterpret_cast<std::uintptr_t>(base);
+    const auto p = reinterpret_cast<ElmType*>((addr + kAlignment - 1) / kAlignment * kAlignment);
+    size_type i = 0;
+    try {
+      for (; i < n; i++) {
+        new(p + i) ElmType;
+      }
+    } catch (...) {
+      AlignedDeleter(base, i)(p);
+      throw;
+    }
+    return pointer_type(p, AlignedDeleter(base, n));
+  }
+
+  void
+  clone(const Array2D& that) const
+  {
+    clone(that, std::integral_constant<bool, std::is_trivially_copyable<ElmType>::value>(), std::integral_constant<bool, Layout::kIsRowMajor>());
+  }
+
+  void
+  clone(const Array2D& that, std::true_type, std::true_type) const
+  {
+    if (nRow == 0 || nCol == 0) {
+      return;
+    }
+    if (getPitch() == that.getPitch()) {
+      std::memcpy(data.get(), that.data.get(), layout.capacity() * sizeof(ElmType));
+      return;
+    }
+    for (size_type i = 0; i < nRow; i++) {
+      std::memcpy((*this)[i], that[i], nCol * sizeof(ElmType));
+    }
+  }
+
+  void
+  clone(const Array2D& that, std::true_type, std::false_type) const
+  {
+    if (layout.capacity() != 0) {
+      std::memcpy(data.get(), that.data.get(), layout.capacity() * sizeof(ElmType));
+    }
+  }
+
+  template<typename IsRowMajor>
   void
-  clone(const Array2D<ElmType>& that) const
+  clone(const Array2D& that, std::false_type, IsRowMajor) const
   {
     for (size_type i = 0; i < nRow; i++) {
       for (size_type j = 0; j < nCol; j++) {
-        (*this)[i][j] = that[i][j];
+        at(i, j) = that.at(i, j);
       }
     }
   }
 public:
   Array2D(size_type nRow, size_type nCol) :
+    Array2D(nRow, nCol, nCol)
+  {}
+
+  /*!
+   * @brief Construct with the specified row pitch
+   * @param [in] nRow    Number of rows
+   * @param [in] nCol    Number of columns
+   * @param [in] nPitch  Number of elements allocated for each row (nPitch >= nCol)
+   */
+  Array2D(size_type nRow, size_type nCol, size_type nPitch) :
     nRow(nRow),
     nCol(nCol),
-    data(new ElmType[nRow * nCol])
-  {}
+    layout(nRow, nCol, nPitch),
+    data(allocate(layout.capacity()))
+  {
+    assert(nPitch >= nCol);
+  }
 
-  Array2D(const Array2D<ElmType>& that) :
+  /*!
+   * @brief Adopt an external buffer without copying
+   *
+   * The buffer is not required to be aligned to kAlignment.
+   * For example, pass munmap() in deleter to adopt an mmap'd region,
+   * or a no-op deleter to wrap memory owned by someone else.
+   *
+   * @tparam Deleter  Function type which equivalent to void(ElmType*)
+   * @param [in] nRow     Number of rows
+   * @param [in] nCol     Number of columns
+   * @param [in] nPitch   Number of elements between the starts of adjacent rows
+   * @param [in] p        Pointer to the buffer of at least nRow * nPitch elements
+   * @param [in] deleter  Function which is called with p to release the buffer
+   *                      (immediately if p is null)
+   */
+  template<typename Deleter>
+  Array2D(size_type nRow, size_type nCol, size_type nPitch, ElmType* p, Deleter deleter) :
+    nRow(nRow),
+    nCol(nCol),
+    layout(nRow, nCol, nPitch),
+    data()
+  {
+    static_assert(Layout::kIsRowMajor, "[Array2D] Adopting a buffer requires row-major layout");
+    assert(nPitch >= nCol);
+    if (p == nullptr) {
+      // unique_ptr never calls its deleter for null, so release right now
+      deleter(p);
+      return;
+    }
+    Releaser* releaser;
+    try {
+      releaser = new ReleaserImpl<Deleter>(deleter);
+    } catch (...) {
+      deleter(p);
+      throw;
+    }
+    data = pointer_type(p, AlignedDeleter(releaser, AlignedDeleter::kAdopted));
+  }
+
+  /*!
+   * @brief Adopt the buffer of std::vector without copying
+   * @param [in] nRow  Number of rows
+   * @param [in] nCol  Number of columns
+   * @param [in] vec   Row-major elements (size must be nRow * nCol)
+   */
+  Array2D(size_type nRow, size_type nCol, std::vector<ElmType>&& vec) :
+    nRow(nRow),
+    nCol(nCol),
+    layout(nRow, nCol, nCol),
+    data()
+  {
+    static_assert(Layout::kIsRowMajor, "[Array2D] Adopting a buffer requires row-major layout");
+    assert(vec.size() == nRow * nCol);
+    if (vec.data() == nullptr) {
+      return;
+    }
+    const auto releaser = new ReleaserImpl<VectorReleaser>(VectorReleaser());
+    releaser->deleter.vec = std::move(vec);
+    data = pointer_type(releaser->deleter.vec.data(), AlignedDeleter(releaser, AlignedDeleter::kAdopted));
+  }
+
+  Array2D(const Array2D& that) :
     nRow(that.nRow),
     nCol(that.nCol),
-    data(new ElmType[nRow * nCol])
+    layout(that.layout),
+    data(allocate(layout.capacity()))
   {
     clone(that);
   }
 
-#if __cplusplus < 201103L
-  ~Array2D()
+  Array2D(Array2D&& that) noexcept :
+    nRow(that.nRow),
+    nCol(that.nCol),
+    layout(that.layout),
+    data(std::move(that.data))
   {
-    delete[] data;
+    that.nRow = 0;
+    that.nCol = 0;
+    that.layout = Layout();
   }
-#endif
 
   void
   fill(const ElmType& value) const
   {
-    std::fill_n(data, nRow * nCol, value);
+    std::fill_n(data.get(), layout.capacity(), value);
   }
 
   ElmType&
   at(size_type y, size_type x) const
   {
     assert(y < nRow && x < nCol);
-    return data[y * nCol + x];
+    return data.get()[layout.index(y, x)];
   }
 
   size_type
@@ -77,38 +795,117 @@ public:
     return nCol;
   }
 
+  //! Number of elements between the starts of adjacent rows
+  size_type
+  getPitch() const
+  {
+    static_assert(Layout::kIsRowMajor, "[Array2D] Pitch is defined only for row-major layout");
+    return layout.getPitch();
+  }
+
+  const Layout&
+  getLayout() const
+  {
+    return layout;
+  }
+
+  //! Iterator to the first element in the order of storage
+  iterator
+  begin() const
+  {
+    return iterator(data.get(), &layout, nRow, nCol, 0);
+  }
+
+  iterator
+  end() const
+  {
+    return iterator(data.get(), &layout, nRow, nCol, layout.capacity());
+  }
+
+  ElmType*
+  getData() const
+  {
+    return data.get();
+  }
+
   ElmType*
   operator[](size_type y) const
   {
-    return &data[y * nCol];
+    return &data.get()[y * getPitch()];
+  }
+
+  Array2DView<ElmType>
+  view() const noexcept
+  {
+    return Array2DView<ElmType>(data.get(), nRow, nCol, getPitch());
+  }
+
+  /*!
+   * @brief Get non-owning view of sub-array
+   * @see Array2DView::subView
+   */
+  Array2DView<ElmType>
+  subView(size_type y, size_type x, size_type nRow, size_type nCol, size_type rowStep = 1, size_type colStep = 1) const noexcept
+  {
+    return view().subView(y, x, nRow, nCol, rowStep, colStep);
   }
 
-  Array2D<ElmType>&
-  operator=(const Array2D<ElmType>& that)
+  Array2D&
+  operator=(const Array2D& that)
   {
+    if (this == &that) {
+      return *this;
+    }
+    if (layout.capacity() != that.layout.capacity()) {
+      data = allocate(that.layout.capacity());
+    }
     nRow = that.nRow;
     nCol = that.nCol;
-    data = new ElmType[nRow * nCol];
+    layout = that.layout;
     clone(that);
     return *this;
   }
 
+  Array2D&
+  operator=(Array2D&& that) noexcept
+  {
+    nRow = that.nRow;
+    nCol = that.nCol;
+    layout = that.layout;
+    data = std::move(that.data);
+    that.nRow = 0;
+    that.nCol = 0;
+    that.layout = Layout();
+    return *this;
+  }
+
   template<typename CharT, typename Traits>
   friend std::basic_ostream<CharT, Traits>&
-  operator<<(std::basic_ostream<CharT, Traits>& os, const Array2D<ElmType>& this_)
+  operator<<(std::basic_ostream<CharT, Traits>& os, const Array2D& this_)
   {
     os << "{\n";
     for (size_type i = 0; i < this_.nRow; i++) {
       os << "  {";
       for (size_type j = 0, jMax = this_.nCol - 1; j < jMax; j++) {
-        os << this_[i][j] << ", ";
+        os << this_.at(i, j) << ", ";
       }
-      os << this_[i][this_.nCol - 1] << "}\n";
+      os << this_.at(i, this_.nCol - 1) << "}\n";
     }
     os << "}";
     return os;
   }
 };  // class Array2D
 
+template<
+  typename ElmType,
+  typename Layout
+>
+constexpr typename Array2D<ElmType, Layout>::size_type Array2D<ElmType, Layout>::kAlignment;
+template<
+  typename ElmType,
+  typename Layout
+>
+constexpr typename Array2D<ElmType, Layout>::size_type Array2D<ElmType, Layout>::AlignedDeleter::kAdopted;
+
 
 #endif  // ARRAY2D_HPP
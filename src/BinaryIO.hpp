@@ -0,0 +1,388 @@
+/*!
+ * @file BinaryIO.hpp
+ * @brief Raw binary serialization of Array2D and Matrix
+ * @author koturn
+ *
+ * A file consists of a 64-byte header followed by row-major elements
+ * without padding.
+ * The header holds the dimensions, the element type and the byte order
+ * of the writer, so that a reader can reject mismatched files.
+ */
+#ifndef BINARY_IO_HPP
+#define BINARY_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif  // defined(__unix__) || defined(__APPLE__)
+
+#include "Array2D.hpp"
+#include "Matrix.hpp"
+
+
+/*!
+ * @brief Identifier of element type stored in the header
+ *
+ * Types other than fundamental arithmetic types are stored as kRaw and
+ * only their size is checked on reading.
+ */
+enum class BinaryElementType : std::uint32_t
+{
+  kRaw = 0,
+  kInt8,
+  kUInt8,
+  kInt16,
+  kUInt16,
+  kInt32,
+  kUInt32,
+  kInt64,
+  kUInt64,
+  kFloat,
+  kDouble,
+  kLongDouble
+};  // enum class BinaryElementType
+
+
+template<typename T>
+static inline constexpr BinaryElementType
+binaryElementTypeOf() noexcept
+{
+  return std::is_same<T, float>::value ? BinaryElementType::kFloat
+    : std::is_same<T, double>::value ? BinaryElementType::kDouble
+    : std::is_same<T, long double>::value ? BinaryElementType::kLongDouble
+    : !std::is_integral<T>::value || std::is_same<T, bool>::value ? BinaryElementType::kRaw
+    : sizeof(T) == 1 ? (std::is_signed<T>::value ? BinaryElementType::kInt8 : BinaryElementType::kUInt8)
+    : sizeof(T) == 2 ? (std::is_signed<T>::value ? BinaryElementType::kInt16 : BinaryElementType::kUInt16)
+    : sizeof(T) == 4 ? (std::is_signed<T>::value ? BinaryElementType::kInt32 : BinaryElementType::kUInt32)
+    : sizeof(T) == 8 ? (std::is_signed<T>::value ? BinaryElementType::kInt64 : BinaryElementType::kUInt64)
+    : BinaryElementType::kRaw;
+}
+
+
+/*!
+ * @brief Header of binary file, which is 64 bytes so that elements are aligned
+ */
+struct BinaryHeader
+{
+  static constexpr std::uint32_t kMagic = 0x44324143;  // "CA2D" in little endian
+  static constexpr std::uint32_t kVersion = 1;
+  static constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+  //! Magic number to identify the format
+  std::uint32_t magic;
+  //! Format version
+  std::uint32_t version;
+  //! kByteOrderMark as written by the writer
+  std::uint32_t byteOrderMark;
+  //! BinaryElementType of elements
+  std::uint32_t elementType;
+  //! Size of an element in bytes
+  std::uint64_t elementSize;
+  //! Number of rows
+  std::uint64_t nRow;
+  //! Number of columns
+  std::uint64_t nCol;
+  //! Reserved for future use, always zero
+  std::uint8_t reserved[24];
+};  // struct BinaryHeader
+
+static_assert(sizeof(BinaryHeader) == 64, "[BinaryHeader] Header must be 64 bytes");
+
+
+template<typename T>
+static inline BinaryHeader
+makeBinaryHeader(std::size_t nRow, std::size_t nCol) noexcept
+{
+  BinaryHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = BinaryHeader::kMagic;
+  header.version = BinaryHeader::kVersion;
+  header.byteOrderMark = BinaryHeader::kByteOrderMark;
+  header.elementType = static_cast<std::uint32_t>(binaryElementTypeOf<T>());
+  header.elementSize = sizeof(T);
+  header.nRow = nRow;
+  header.nCol = nCol;
+  return header;
+}
+
+
+/*!
+ * @brief Validate header
+ * @param [in] header     Header read from file
+ * @param [in] allowSwap  Allow byte order different from this machine
+ * @return Return true if bytes of each element have to be reversed
+ */
+template<typename T>
+static inline bool
+checkBinaryHeader(const BinaryHeader& header, bool allowSwap)
+{
+  if (header.magic != BinaryHeader::kMagic) {
+    throw std::runtime_error("[BinaryIO] Not a binary array file");
+  }
+  if (header.version != BinaryHeader::kVersion) {
+    throw std::runtime_error("[BinaryIO] Unsupported format version");
+  }
+  const auto isSwapped = header.byteOrderMark != BinaryHeader::kByteOrderMark;
+  if (isSwapped && (!allowSwap || header.byteOrderMark != 0x04030201 || binaryElementTypeOf<T>() == BinaryElementType::kRaw)) {
+    throw std::runtime_error("[BinaryIO] Byte order mismatch");
+  }
+  // Fields of a swapped header are compared after swapping by the caller
+  if (!isSwapped && (header.elementType != static_cast<std::uint32_t>(binaryElementTypeOf<T>()) || header.elementSize != sizeof(T))) {
+    throw std::runtime_error("[BinaryIO] Element type mismatch");
+  }
+  return isSwapped;
+}
+
+
+template<typename U>
+static inline U
+byteSwap(U value) noexcept
+{
+  auto p = reinterpret_cast<unsigned char*>(&value);
+  std::reverse(p, p + sizeof(U));
+  return value;
+}
+
+
+/*!
+ * @brief Bring magic and version of a header written in the other byte order to this machine's
+ *
+ * Done before checkBinaryHeader() so that such a file is reported as a byte
+ * order mismatch rather than as a foreign file.
+ */
+static inline void
+normalizeBinaryHeaderId(BinaryHeader& header) noexcept
+{
+  if (header.byteOrderMark != BinaryHeader::kByteOrderMark) {
+    header.magic = byteSwap(header.magic);
+    header.version = byteSwap(header.version);
+  }
+}
+
+
+static inline void
+swapBinaryHeader(BinaryHeader& header) noexcept
+{
+  header.elementType = byteSwap(header.elementType);
+  header.elementSize = byteSwap(header.elementSize);
+  header.nRow = byteSwap(header.nRow);
+  header.nCol = byteSwap(header.nCol);
+}
+
+
+/*!
+ * @brief Read header from stream and check it
+ *
+ * If the stream is seekable, the dimensions are also checked against the
+ * remaining length, so that a corrupt header does not cause a huge allocation.
+ *
+ * @return Return true if bytes of each element have to be reversed
+ */
+template<typename T>
+static inline bool
+readBinaryHeader(std::istream& is, BinaryHeader& header)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "[readBinaryHeader] Element type must be trivially copyable");
+
+  if (!is.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    throw std::runtime_error("[BinaryIO] Failed to read header");
+  }
+  normalizeBinaryHeaderId(header);
+  const auto isSwapped = checkBinaryHeader<T>(header, true);
+  if (isSwapped) {
+    swapBinaryHeader(header);
+    if (header.elementType != static_cast<std::uint32_t>(binaryElementTypeOf<T>()) || header.elementSize != sizeof(T)) {
+      throw std::runtime_error("[BinaryIO] Element type mismatch");
+    }
+  }
+  const auto pos = is.tellg();
+  if (pos != std::istream::pos_type(-1) && is.seekg(0, std::ios::end)) {
+    const auto length = static_cast<std::uint64_t>(is.tellg() - pos);
+    is.seekg(pos);
+    if (length / sizeof(T) / std::max<std::uint64_t>(header.nCol, 1) < header.nRow) {
+      throw std::runtime_error("[BinaryIO] Unexpected end of file");
+    }
+  }
+  is.clear();
+  return isSwapped;
+}
+
+
+template<typename T>
+static inline void
+readBinaryRow(std::istream& is, T* row, std::size_t nCol, bool isSwapped)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "[readBinaryRow] Element type must be trivially copyable");
+  if (!is.read(reinterpret_cast<char*>(row), static_cast<std::streamsize>(nCol * sizeof(T)))) {
+    throw std::runtime_error("[BinaryIO] Unexpected end of file");
+  }
+  if (isSwapped) {
+    std::transform(row, row + nCol, row, byteSwap<T>);
+  }
+}
+
+
+/*!
+ * @brief Write Array2D in binary format
+ * @param [out] os   Output stream opened in binary mode
+ * @param [in]  arr  Array to write
+ */
+template<typename T>
+static inline void
+writeBinary(std::ostream& os, const Array2D<T>& arr)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "[writeBinary] Element type must be trivially copyable");
+  const auto header = makeBinaryHeader<T>(arr.getNRow(), arr.getNCol());
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (arr.getNCol() == arr.getPitch() && arr.getNRow() != 0) {
+    os.write(reinterpret_cast<const char*>(arr.getData()), static_cast<std::streamsize>(arr.getNRow() * arr.getNCol() * sizeof(T)));
+    return;
+  }
+  for (std::size_t i = 0; i < arr.getNRow(); i++) {
+    os.write(reinterpret_cast<const char*>(arr[i]), static_cast<std::streamsize>(arr.getNCol() * sizeof(T)));
+  }
+}
+
+
+/*!
+ * @brief Write Matrix in binary format
+ * @param [out] os   Output stream opened in binary mode
+ * @param [in]  mat  Matrix to write
+ */
+template<typename T>
+static inline void
+writeBinary(std::ostream& os, const Matrix<T>& mat)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "[writeBinary] Element type must be trivially copyable");
+  const auto header = makeBinaryHeader<T>(mat.getNRow(), mat.getNCol());
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (mat.getNRow() != 0) {
+    os.write(reinterpret_cast<const char*>(mat[0]), static_cast<std::streamsize>(mat.getNRow() * mat.getNCol() * sizeof(T)));
+  }
+}
+
+
+template<typename Container>
+static inline void
+writeBinary(const std::string& path, const Container& c)
+{
+  std::ofstream ofs(path, std::ios::binary);
+  if (!ofs) {
+    throw std::runtime_error("[writeBinary] Failed to open " + path);
+  }
+  writeBinary(ofs, c);
+  if (!ofs.flush()) {
+    throw std::runtime_error("[writeBinary] Failed to write " + path);
+  }
+}
+
+
+/*!
+ * @brief Read Array2D in binary format
+ *
+ * Files written on a machine of different byte order are converted
+ * for fundamental arithmetic element types.
+ *
+ * @param [in] is  Input stream opened in binary mode
+ * @return Array read from the stream
+ */
+template<typename T>
+static inline Array2D<T>
+readArray2DBinary(std::istream& is)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "[readArray2DBinary] Element type must be trivially copyable");
+  BinaryHeader header;
+  const auto isSwapped = readBinaryHeader<T>(is, header);
+  Array2D<T> arr(static_cast<std::size_t>(header.nRow), static_cast<std::size_t>(header.nCol));
+  for (std::size_t i = 0; i < arr.getNRow(); i++) {
+    readBinaryRow(is, arr[i], arr.getNCol(), isSwapped);
+  }
+  return arr;
+}
+
+
+/*!
+ * @brief Read Matrix in binary format
+ * @param [in] is  Input stream opened in binary mode
+ * @return Matrix read from the stream
+ */
+template<typename T>
+static inline Matrix<T>
+readMatrixBinary(std::istream& is)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "[readMatrixBinary] Element type must be trivially copyable");
+  BinaryHeader header;
+  const auto isSwapped = readBinaryHeader<T>(is, header);
+  Matrix<T> mat(static_cast<std::size_t>(header.nRow), static_cast<std::size_t>(header.nCol));
+  for (std::size_t i = 0; i < mat.getNRow(); i++) {
+    readBinaryRow(is, mat[i], mat.getNCol(), isSwapped);
+  }
+  return mat;
+}
+
+
+#if defined(__unix__) || defined(__APPLE__)
+/*!
+ * @brief Map a binary file into memory as Array2D without copying
+ *
+ * The file is mapped privately, so writes to the array are not reflected
+ * in the file. The mapping is released when the array is destructed.
+ * The byte order of the file must match this machine.
+ *
+ * @param [in] path  Path to the file
+ * @return Array which refers the mapped file
+ */
+template<typename T>
+static inline Array2D<T>
+mapArray2DBinary(const std::string& path)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "[mapArray2DBinary] Element type must be trivially copyable");
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("[mapArray2DBinary] Failed to open " + path);
+  }
+  struct stat st;
+  if (::fstat(fd, &st) == -1 || static_cast<std::size_t>(st.st_size) < sizeof(BinaryHeader)) {
+    ::close(fd);
+    throw std::runtime_error("[mapArray2DBinary] Invalid file " + path);
+  }
+  const auto length = static_cast<std::size_t>(st.st_size);
+  const auto addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    throw std::runtime_error("[mapArray2DBinary] Failed to map " + path);
+  }
+  const auto base = static_cast<char*>(addr);
+  try {
+    BinaryHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    normalizeBinaryHeaderId(header);
+    checkBinaryHeader<T>(header, false);
+    if ((length - sizeof(header)) / sizeof(T) / std::max<std::uint64_t>(header.nCol, 1) < header.nRow) {
+      throw std::runtime_error("[mapArray2DBinary] Unexpected end of file " + path);
+    }
+    const auto nRow = static_cast<std::size_t>(header.nRow);
+    const auto nCol = static_cast<std::size_t>(header.nCol);
+    return Array2D<T>(nRow, nCol, nCol, reinterpret_cast<T*>(base + sizeof(header)), [base, length](T*) {
+      ::munmap(base, length);
+    });
+  } catch (...) {
+    ::munmap(base, length);
+    throw;
+  }
+}
+#endif  // defined(__unix__) || defined(__APPLE__)
+
+
+#endif  // BINARY_IO_HPP
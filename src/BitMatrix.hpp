@@ -0,0 +1,296 @@
+/*!
+ * @file BitMatrix.hpp
+ * @brief Matrix over GF(2) whose rows are packed into 64-bit words
+ * @author koturn
+ */
+#ifndef BIT_MATRIX_HPP
+#define BIT_MATRIX_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "Bits.hpp"
+
+
+/*!
+ * @brief Matrix over GF(2)
+ *
+ * Each row is packed into 64-bit words, so that row operations of
+ * Gaussian elimination are word-parallel XOR (AVX2 when available).
+ * It uses 1/32 memory of Matrix<int>.
+ */
+class BitMatrix
+{
+public:
+  typedef std::size_t size_type;
+  typedef std::uint64_t word_type;
+
+  static constexpr size_type kWordBits = 64;
+
+  BitMatrix(size_type nRow, size_type nCol)
+    : m_nRow(nRow)
+    , m_nCol(nCol)
+    , m_nWord((nCol + kWordBits - 1) / kWordBits)
+    , m_data(nRow * m_nWord)
+  {}
+
+  size_type
+  getNRow() const noexcept
+  {
+    return m_nRow;
+  }
+
+  size_type
+  getNCol() const noexcept
+  {
+    return m_nCol;
+  }
+
+  bool
+  get(size_type y, size_type x) const noexcept
+  {
+    assert(y < m_nRow && x < m_nCol);
+    return ((row(y)[x / kWordBits] >> (x % kWordBits)) & 1) != 0;
+  }
+
+  void
+  set(size_type y, size_type x, bool value) noexcept
+  {
+    assert(y < m_nRow && x < m_nCol);
+    const auto mask = word_type(1) << (x % kWordBits);
+    auto& w = row(y)[x / kWordBits];
+    w = value ? (w | mask) : (w & ~mask);
+  }
+
+  void
+  flip(size_type y, size_type x) noexcept
+  {
+    assert(y < m_nRow && x < m_nCol);
+    row(y)[x / kWordBits] ^= word_type(1) << (x % kWordBits);
+  }
+
+  /*!
+   * @brief Get pointer to packed words of specified row
+   * @param [in] y  Row index
+   * @return Pointer to the first word of the row
+   */
+  word_type*
+  row(size_type y) noexcept
+  {
+    return &m_data[y * m_nWord];
+  }
+
+  const word_type*
+  row(size_type y) const noexcept
+  {
+    return &m_data[y * m_nWord];
+  }
+
+  /*!
+   * @brief Count set bits of specified row
+   * @param [in] y  Row index
+   * @return Number of ones in the row
+   */
+  size_type
+  countRow(size_type y) const noexcept
+  {
+    const auto r = row(y);
+    size_type cnt = 0;
+    for (size_type i = 0; i < m_nWord; i++) {
+      cnt += static_cast<size_type>(popcnt(r[i]));
+    }
+    return cnt;
+  }
+
+  /*!
+   * @brief Find the first set column of specified row
+   * @param [in] y      Row index
+   * @param [in] first  Column to start searching
+   * @return Column index of the first one, or getNCol() if not found
+   */
+  size_type
+  findFirst(size_type y, size_type first = 0) const noexcept
+  {
+    const auto r = row(y);
+    for (auto i = first / kWordBits; i < m_nWord; i++) {
+      auto w = r[i];
+      if (i == first / kWordBits) {
+        w &= ~word_type(0) << (first % kWordBits);
+      }
+      if (w != 0) {
+        return std::min(m_nCol, i * kWordBits + static_cast<size_type>(bsf(w)));
+      }
+    }
+    return m_nCol;
+  }
+
+  /*!
+   * @brief row(dst) ^= row(src)
+   * @param [in] dst  Destination row index
+   * @param [in] src  Source row index
+   * @param [in] firstWord  Index of word to start XOR (words before it must be zero in src)
+   */
+  void
+  xorRow(size_type dst, size_type src, size_type firstWord = 0) noexcept
+  {
+    xorWords(row(dst) + firstWord, row(src) + firstWord, m_nWord - firstWord);
+  }
+
+  void
+  swapRow(size_type y1, size_type y2) noexcept
+  {
+    std::swap_ranges(row(y1), row(y1) + m_nWord, row(y2));
+  }
+
+  /*!
+   * @brief Transform into reduced row echelon form by Gauss-Jordan elimination
+   * @param [in] nElimCol  Number of columns to eliminate (e.g. exclude augmented columns)
+   * @return Rank of the first nElimCol columns
+   */
+  size_type
+  gaussJordan(size_type nElimCol) noexcept
+  {
+    assert(nElimCol <= m_nCol);
+    size_type rank = 0;
+    for (size_type c = 0; c < nElimCol && rank < m_nRow; c++) {
+      const auto wi = c / kWordBits;
+      const auto mask = word_type(1) << (c % kWordBits);
+      auto p = rank;
+      for (; p < m_nRow && (row(p)[wi] & mask) == 0; p++);
+      if (p == m_nRow) {
+        continue;
+      }
+      if (p != rank) {
+        swapRow(p, rank);
+      }
+      for (size_type i = 0; i < m_nRow; i++) {
+        if (i != rank && (row(i)[wi] & mask) != 0) {
+          xorRow(i, rank, wi);
+        }
+      }
+      rank++;
+    }
+    return rank;
+  }
+
+  size_type
+  gaussJordan() noexcept
+  {
+    return gaussJordan(m_nCol);
+  }
+
+  /*!
+   * @brief Calculate rank
+   * @return Rank of this matrix
+   */
+  size_type
+  rank() const
+  {
+    BitMatrix mat(*this);
+    return mat.gaussJordan();
+  }
+
+  /*!
+   * @brief Solve A x = b over GF(2)
+   *
+   * Free variables are set to zero.
+   * The number of solutions is 2 ** (getNCol() - rank()) if a solution exists.
+   *
+   * @param [in]  b  Right-hand side (size must be getNRow())
+   * @param [out] x  One of solutions (size will be getNCol())
+   * @return Return true if a solution exists, otherwise false
+   */
+  bool
+  solve(const std::vector<bool>& b, std::vector<bool>& x) const
+  {
+    assert(b.size() == m_nRow);
+    BitMatrix aug(m_nRow, m_nCol + 1);
+    for (size_type i = 0; i < m_nRow; i++) {
+      std::copy_n(row(i), m_nWord, aug.row(i));
+      aug.set(i, m_nCol, b[i]);
+    }
+    const auto rank = aug.gaussJordan(m_nCol);
+    for (size_type i = rank; i < m_nRow; i++) {
+      if (aug.get(i, m_nCol)) {
+        return false;
+      }
+    }
+    x.assign(m_nCol, false);
+    for (size_type i = 0; i < rank; i++) {
+      x[aug.findFirst(i)] = aug.get(i, m_nCol);
+    }
+    return true;
+  }
+
+  template<typename CharT, typename Traits>
+  friend std::basic_ostream<CharT, Traits>&
+  operator<<(std::basic_ostream<CharT, Traits>& os, const BitMatrix& this_)
+  {
+    for (size_type i = 0; i < this_.m_nRow; i++) {
+      for (size_type j = 0; j < this_.m_nCol; j++) {
+        os << (this_.get(i, j) ? '1' : '0');
+      }
+      os << '\n';
+    }
+    return os;
+  }
+
+private:
+  /*!
+   * @brief dst[i] ^= src[i] for i in [0, n)
+   *
+   * On x86 with GCC/Clang, 256-bit vectors are used if AVX2 is available.
+   */
+  static void
+  xorWords(word_type* dst, const word_type* src, size_type n) noexcept
+  {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const bool kHasAvx2 = __builtin_cpu_supports("avx2");
+    if (kHasAvx2) {
+      xorWordsAvx2(dst, src, n);
+      return;
+    }
+#endif  // defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    for (size_type i = 0; i < n; i++) {
+      dst[i] ^= src[i];
+    }
+  }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __attribute__((target("avx2")))
+  static void
+  xorWordsAvx2(word_type* dst, const word_type* src, size_type n) noexcept
+  {
+    typedef word_type V __attribute__((vector_size(32)));
+    static constexpr size_type kStep = sizeof(V) / sizeof(word_type);
+
+    size_type i = 0;
+    for (; i + kStep <= n; i += kStep) {
+      V vd, vs;
+      std::memcpy(&vd, dst + i, sizeof(V));
+      std::memcpy(&vs, src + i, sizeof(V));
+      vd ^= vs;
+      std::memcpy(dst + i, &vd, sizeof(V));
+    }
+    for (; i < n; i++) {
+      dst[i] ^= src[i];
+    }
+  }
+#endif  // defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+  //! Number of rows
+  size_type m_nRow;
+  //! Number of columns
+  size_type m_nCol;
+  //! Number of words per row
+  size_type m_nWord;
+  //! Packed rows
+  std::vector<word_type> m_data;
+};  // class BitMatrix
+
+
+#endif  // BIT_MATRIX_HPP
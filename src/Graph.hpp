@@ -7,16 +7,98 @@
 #define GRAPH_HPP
 
 #include <algorithm>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <queue>
 #include <type_traits>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "Parallel.hpp"
 #include "UnionFind.hpp"
 
 
+/*!
+ * @brief Traits of edge cost type which supply infinity and saturating addition
+ *
+ * Specialize this template to use a user-defined cost type with the solvers.
+ * Both functions are constexpr and the selection between integer and floating
+ * point implementation is done at compile time.
+ * inf() is absorbing in add(), so solvers need no separate check for
+ * unreachable nodes.
+ *
+ * @tparam U  Type of edge cost
+ */
+template<
+  typename U,
+  typename = void
+>
+struct CostTraits
+{
+  static_assert(std::is_integral<U>::value, "[CostTraits] Specialize CostTraits for a non-arithmetic cost type");
+
+  /*!
+   * @brief Infinity of cost
+   *
+   * Half of the maximum value is used so that inf() + inf() does not overflow.
+   *
+   * @return Infinity of cost
+   */
+  static constexpr U
+  inf() noexcept
+  {
+    return std::numeric_limits<U>::max() / 2;
+  }
+
+  /*!
+   * @brief Add two costs, saturating to inf()
+   * @param [in] a  First cost (must not exceed inf())
+   * @param [in] b  Second cost (must not exceed inf())
+   * @return inf() if either of a or b is inf(), otherwise min(a + b, inf())
+   */
+  static constexpr U
+  add(U a, U b) noexcept
+  {
+    return a == inf() || b == inf() ? inf()
+      : a + b < inf() ? a + b : inf();
+  }
+};  // struct CostTraits
+
+
+/*!
+ * @brief Traits of floating point edge cost type
+ * @tparam U  Type of edge cost
+ */
+template<typename U>
+struct CostTraits<U, typename std::enable_if<std::is_floating_point<U>::value>::type>
+{
+  /*!
+   * @brief Infinity of cost
+   * @return Infinity of cost
+   */
+  static constexpr U
+  inf() noexcept
+  {
+    return std::numeric_limits<U>::infinity();
+  }
+
+  /*!
+   * @brief Add two costs (IEEE 754 arithmetic already saturates to infinity)
+   * @param [in] a  First cost
+   * @param [in] b  Second cost
+   * @return a + b
+   */
+  static constexpr U
+  add(U a, U b) noexcept
+  {
+    return a + b;
+  }
+};  // struct CostTraits
+
+
 template<
   typename T,
   typename U
@@ -91,6 +173,13 @@ public:
     , m_vertex()
   {}
 
+  //! Edge list, which addEdge() fills with both directions
+  const std::vector<Edge<T, U>>&
+  getGraph() const noexcept
+  {
+    return m_graph;
+  }
+
 private:
   void
   addEdge_(T from, T to, U cost) noexcept
@@ -110,16 +199,17 @@ private:
   std::vector<U>
   shortestPath_(T from) const noexcept
   {
-    static constexpr int kInf = 0x3f3f3f3f;
-    std::vector<U> dists(m_vertex.size());
-    std::fill(std::begin(dists), std::end(dists), kInf);
+    using Traits = CostTraits<U>;
+
+    std::vector<U> dists(m_vertex.size(), Traits::inf());
     dists[from] = 0;
     for (;;) {
       auto isUpdated = false;
       for (typename decltype(m_graph)::size_type i = 0; i < m_graph.size(); i++) {
         const auto& e = m_graph[i];
-        if (dists[e.from] != kInf && dists[e.to] > dists[e.from] + e.cost) {
-          dists[e.to] = dists[e.from] + e.cost;
+        const auto d = Traits::add(dists[e.from], e.cost);
+        if (dists[e.to] > d) {
+          dists[e.to] = d;
           isUpdated = true;
         }
       }
@@ -155,12 +245,19 @@ public:
     , m_vertex()
   {}
 
+  //! Adjacency list, element i holds the edges from node i
+  const std::vector<std::vector<Edge<T, U>>>&
+  getGraph() const noexcept
+  {
+    return m_graph;
+  }
+
 private:
   void
   addEdge_(T from, T to, U cost) noexcept
   {
     addDirectedEdge_(from, to, cost);
-    m_graph[to].emplace_back(from, to, cost);
+    m_graph[to].emplace_back(to, from, cost);
   }
 
   void
@@ -180,11 +277,10 @@ private:
   {
     // first is shortest distance，second is vertex node number
     using P = std::pair<U, T>;
+    using Traits = CostTraits<U>;
 
-    static constexpr int kInf = 0x3f3f3f3f;
     std::priority_queue<P, std::vector<P>, std::greater<P>> pQueue;
-    std::vector<U> dists(m_vertex.size());
-    std::fill(dists.begin(), dists.end(), kInf);
+    std::vector<U> dists(m_vertex.size(), Traits::inf());
     dists[from] = 0;
     pQueue.emplace(0, from);
     while (!pQueue.empty()) {
@@ -196,8 +292,9 @@ private:
       }
       for (typename decltype(m_graph)::size_type i = 0; i < m_graph[v].size(); i++) {
         const auto& e = m_graph[v][i];
-        if (dists[e.to] > dists[v] + e.cost) {
-          dists[e.to] = dists[v] + e.cost;
+        const auto d = Traits::add(dists[v], e.cost);
+        if (dists[e.to] > d) {
+          dists[e.to] = d;
           pQueue.emplace(dists[e.to], e.to);
         }
       }
@@ -225,7 +322,7 @@ public:
     , m_graph(new U[kDefaultSize * kDefaultSize])
     , m_vertex()
   {
-    std::fill_n(m_graph.get(), kDefaultSize * kDefaultSize, kInf);
+    std::fill_n(m_graph.get(), kDefaultSize * kDefaultSize, Traits::inf());
     for (decltype(m_nVertex) i = 0; i < m_nVertex; i++) {
       m_graph[i *  m_nVertex + i] = 0;
     }
@@ -236,7 +333,7 @@ public:
     , m_graph(new U[v * v])
     , m_vertex()
   {
-    std::fill_n(m_graph.get(), v * v, kInf);
+    std::fill_n(m_graph.get(), v * v, Traits::inf());
     for (decltype(m_nVertex) i = 0; i < m_nVertex; i++) {
       m_graph[i *  m_nVertex + i] = 0;
     }
@@ -267,12 +364,12 @@ private:
       }
       for (SizeType i = 0; i < m_nVertex; i++) {
         for (SizeType j = m_nVertex; j < m; j++) {
-          m_graph[i * m + j] = kInf;
+          m_graph[i * m + j] = Traits::inf();
         }
       }
       for (SizeType i = m_nVertex; i < m; i++) {
         for (SizeType j = 0; j < m; j++) {
-          m_graph[i * m + j] = kInf;
+          m_graph[i * m + j] = Traits::inf();
         }
       }
       for (SizeType i = 0; i < m; i++) {
@@ -291,7 +388,7 @@ private:
     for (SizeType k = 0; k < m_nVertex; k++) {
       for (SizeType i = 0; i < m_nVertex; i++) {
         for (SizeType j = 0; j < m_nVertex; j++) {
-          m_graph[i * m_nVertex + j] = std::min(m_graph[i * m_nVertex + j], m_graph[i * m_nVertex + k] + m_graph[k * m_nVertex + j]);
+          m_graph[i * m_nVertex + j] = std::min(m_graph[i * m_nVertex + j], Traits::add(m_graph[i * m_nVertex + k], m_graph[k * m_nVertex + j]));
         }
       }
     }
@@ -299,8 +396,9 @@ private:
     return std::vector<U>(ptr, ptr + m_nVertex);
   }
 
+  using Traits = CostTraits<U>;
+
   static constexpr std::size_t kDefaultSize = 16;
-  static constexpr int kInf = 0x3f3f3f3f;
   std::size_t m_nVertex;
   std::unique_ptr<U[]> m_graph;
   std::unordered_set<T> m_vertex;
@@ -340,6 +438,13 @@ public:
     return static_cast<C*>(this)->solve_();
   }
 
+  //! Adjacency list, element i holds the edges from node i
+  const std::vector<std::vector<E>>&
+  getGraph() const noexcept
+  {
+    return m_graph;
+  }
+
 protected:
   std::vector<std::vector<E>>&
   getGraphRef() noexcept
@@ -459,4 +564,92 @@ private:
 };  // class SpanningTreeKruskal
 
 
+
+/*!
+ * @brief Compute connected components of an undirected graph in parallel
+ *
+ * Edges are united concurrently with ConcurrentUnionFind,
+ * then every node is resolved to its root and roots are relabeled to dense
+ * numbers [0, number of components) with a parallel prefix sum.
+ *
+ * @tparam Iterator  Random access iterator of Edge<T, U>
+ * @tparam T  Type of node number (integer)
+ * @param [in] first     Start of edges
+ * @param [in] last      End of edges
+ * @param [in] n         Number of node
+ * @param [in] policy    Parallel policy
+ * @return Component labels of each node
+ */
+template<
+  typename Iterator,
+  typename T
+>
+static inline std::vector<T>
+connectedComponents(Iterator first, Iterator last, T n, const ParallelPolicy& policy = ParallelPolicy())
+{
+  static_assert(std::is_integral<T>::value, "[connectedComponents] Type of node must be an integer");
+
+  ConcurrentUnionFind<T> uf(n);
+  const auto nEdges = static_cast<std::size_t>(std::distance(first, last));
+  parallelForChunk(nEdges, 1, policy, [&uf, first](unsigned int, std::size_t l, std::size_t r) {
+    for (auto it = std::next(first, l), end = std::next(first, r); it != end; ++it) {
+      uf.unite(it->from, it->to);
+    }
+  });
+
+  // Resolve roots and count them for each chunk
+  const auto nNodes = static_cast<std::size_t>(n);
+  std::vector<T> labels(nNodes);
+  std::vector<T> offsets(policy.nThreads + 1);
+  parallelForChunk(nNodes, 1, policy, [&uf, &labels, &offsets](unsigned int t, std::size_t l, std::size_t r) {
+    T cnt = 0;
+    for (auto i = l; i < r; i++) {
+      labels[i] = uf.find(static_cast<T>(i));
+      if (labels[i] == static_cast<T>(i)) {
+        cnt++;
+      }
+    }
+    offsets[t + 1] = cnt;
+  });
+  std::partial_sum(std::begin(offsets), std::end(offsets), std::begin(offsets));
+
+  // Assign dense labels to roots, then to the other nodes
+  std::vector<T> ids(nNodes);
+  parallelForChunk(nNodes, 1, policy, [&labels, &offsets, &ids](unsigned int t, std::size_t l, std::size_t r) {
+    auto id = offsets[t];
+    for (auto i = l; i < r; i++) {
+      if (labels[i] == static_cast<T>(i)) {
+        ids[i] = id++;
+      }
+    }
+  });
+  parallelForChunk(nNodes, 1, policy, [&labels, &ids](unsigned int, std::size_t l, std::size_t r) {
+    for (auto i = l; i < r; i++) {
+      labels[i] = ids[labels[i]];
+    }
+  });
+  return labels;
+}
+
+
+/*!
+ * @brief Compute connected components of an undirected graph in parallel
+ * @tparam T  Type of node number (integer)
+ * @tparam U  Type of edge cost
+ * @param [in] edges     Edges of the graph
+ * @param [in] n         Number of node
+ * @param [in] policy    Parallel policy
+ * @return Component labels of each node
+ */
+template<
+  typename T,
+  typename U
+>
+static inline std::vector<T>
+connectedComponents(const std::vector<Edge<T, U>>& edges, T n, const ParallelPolicy& policy = ParallelPolicy())
+{
+  return connectedComponents(std::begin(edges), std::end(edges), n, policy);
+}
+
+
 #endif  // GRAPH_HPP
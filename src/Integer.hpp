@@ -7,7 +7,10 @@
 #define INTEGER_HPP
 
 #include <cmath>
+#include <cstdint>
 #include <algorithm>
+#include <iostream>
+#include <limits>
 #include <numeric>
 #include <tuple>
 #include <type_traits>
@@ -690,4 +693,168 @@ mobiusMu(T n) noexcept
 }
 
 
+
+/*!
+ * @brief Integer modulo kMod
+ *
+ * Values are kept in [0, kMod) as 32-bit unsigned integers.
+ * Since kMod is a compile time constant, compilers replace the remainder
+ * operation with Barrett-style multiplication and shifts.
+ *
+ * @tparam kMod  Modulo (must be a prime for division)
+ */
+template<std::uint32_t kMod>
+class ModInt
+{
+  static_assert(kMod >= 2 && kMod <= (1u << 31), "[ModInt] Modulo must be in [2, 2^31]");
+
+public:
+  //! Modulo
+  static constexpr std::uint32_t kModulo = kMod;
+
+  ModInt() noexcept
+    : m_value(0)
+  {}
+
+  template<typename T, typename std::enable_if<std::is_integral<T>::value, std::nullptr_t>::type = nullptr>
+  ModInt(T value) noexcept
+    : m_value(normalize(value))
+  {}
+
+  /*!
+   * @brief Construct from a value in [0, kMod) without reduction
+   * @param [in] value  Value in [0, kMod)
+   * @return ModInt whose value is specified value
+   */
+  static ModInt
+  raw(std::uint32_t value) noexcept
+  {
+    ModInt m;
+    m.m_value = value;
+    return m;
+  }
+
+  std::uint32_t
+  value() const noexcept
+  {
+    return m_value;
+  }
+
+  /*!
+   * @brief Calculate multiplicative inverse by Fermat's little theorem
+   * @return Inverse of this value
+   */
+  ModInt
+  inverse() const noexcept
+  {
+    return pow(kMod - 2);
+  }
+
+  ModInt
+  pow(std::uint64_t p) const noexcept
+  {
+    return raw(static_cast<std::uint32_t>(modpow<kMod>(m_value, p)));
+  }
+
+  ModInt&
+  operator+=(const ModInt& that) noexcept
+  {
+    m_value += that.m_value;
+    if (m_value >= kMod) {
+      m_value -= kMod;
+    }
+    return *this;
+  }
+
+  ModInt&
+  operator-=(const ModInt& that) noexcept
+  {
+    m_value += kMod - that.m_value;
+    if (m_value >= kMod) {
+      m_value -= kMod;
+    }
+    return *this;
+  }
+
+  ModInt&
+  operator*=(const ModInt& that) noexcept
+  {
+    m_value = static_cast<std::uint32_t>(static_cast<std::uint64_t>(m_value) * that.m_value % kMod);
+    return *this;
+  }
+
+  ModInt&
+  operator/=(const ModInt& that) noexcept
+  {
+    return *this *= that.inverse();
+  }
+
+  ModInt
+  operator-() const noexcept
+  {
+    return raw(m_value == 0 ? 0 : kMod - m_value);
+  }
+
+  friend ModInt
+  operator+(ModInt lhs, const ModInt& rhs) noexcept
+  {
+    return lhs += rhs;
+  }
+
+  friend ModInt
+  operator-(ModInt lhs, const ModInt& rhs) noexcept
+  {
+    return lhs -= rhs;
+  }
+
+  friend ModInt
+  operator*(ModInt lhs, const ModInt& rhs) noexcept
+  {
+    return lhs *= rhs;
+  }
+
+  friend ModInt
+  operator/(ModInt lhs, const ModInt& rhs) noexcept
+  {
+    return lhs /= rhs;
+  }
+
+  friend bool
+  operator==(const ModInt& lhs, const ModInt& rhs) noexcept
+  {
+    return lhs.m_value == rhs.m_value;
+  }
+
+  friend bool
+  operator!=(const ModInt& lhs, const ModInt& rhs) noexcept
+  {
+    return lhs.m_value != rhs.m_value;
+  }
+
+  template<typename CharT, typename Traits>
+  friend std::basic_ostream<CharT, Traits>&
+  operator<<(std::basic_ostream<CharT, Traits>& os, const ModInt& this_)
+  {
+    return os << this_.m_value;
+  }
+
+private:
+  template<typename T>
+  static std::uint32_t
+  normalize(T value) noexcept
+  {
+    return std::is_signed<T>::value && value < 0
+      ? static_cast<std::uint32_t>(kMod - 1 - static_cast<std::uint64_t>(-(value + 1)) % kMod)
+      : static_cast<std::uint32_t>(static_cast<std::uint64_t>(value) % kMod);
+  }
+
+  //! Value in [0, kMod)
+  std::uint32_t m_value;
+};  // class ModInt
+
+
+template<std::uint32_t kMod>
+constexpr std::uint32_t ModInt<kMod>::kModulo;
+
+
 #endif  // INTEGER_HPP
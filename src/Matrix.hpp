@@ -4,79 +4,914 @@
 #include <cassert>
 #include <cstring>
 #include <algorithm>
+#include <initializer_list>
 #include <iostream>
 #include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Integer.hpp"
+#include "Parallel.hpp"
+
+
+template<typename ElmType>
+class Matrix;
+
+template<typename ElmType>
+class LUDecomposition;
+
+
+/*!
+ * @brief Customization point of accumulation in matrix product kernels
+ *
+ * Products are accumulated into AccumulatorType with madd(),
+ * reduce() is called every kReduceInterval products (0 means never),
+ * and toElement() converts an accumulator into an element.
+ * Matrix::mul() switches to Strassen-Winograd for square operands larger
+ * than kStrassenCutoff (0 means never, as for floating point, whose error
+ * grows with Strassen).
+ *
+ * @tparam ElmType  Type of element
+ */
+template<typename ElmType>
+struct MatrixKernelTraits
+{
+  typedef ElmType AccumulatorType;
+
+  static constexpr std::size_t kReduceInterval = 0;
+  //! Measured with -O3 -march=native on x86-64, where 64-bit products are slower than 32-bit ones
+  static constexpr std::size_t kStrassenCutoff = !std::is_integral<ElmType>::value || std::is_same<ElmType, bool>::value ? 0
+    : sizeof(ElmType) <= 4 ? 128
+    : 64;
+
+  static void
+  madd(AccumulatorType& acc, const ElmType& a, const ElmType& b)
+  {
+    acc += a * b;
+  }
+
+  static void
+  reduce(AccumulatorType&)
+  {}
+
+  static ElmType
+  toElement(const AccumulatorType& acc)
+  {
+    return acc;
+  }
+};  // struct MatrixKernelTraits
+
+
+/*!
+ * @brief Lazy reduction for ModInt
+ *
+ * Products of two values less than kMod are summed up in 64 bits and
+ * reduced only when the next product may overflow (about every 18 products
+ * for 998244353), rather than once per k-block.  The % by the constant kMod
+ * compiles to a multiply and shift, and unsigned __int128 accumulators or a
+ * branchless subtraction of a multiple of kMod^2 per product were 3-4x
+ * slower because they keep the micro kernel from being vectorized.
+ *
+ * @tparam kMod  Modulo
+ */
+template<std::uint32_t kMod>
+struct MatrixKernelTraits<ModInt<kMod> >
+{
+  typedef std::uint64_t AccumulatorType;
+
+  static constexpr std::size_t kReduceInterval = static_cast<std::size_t>(
+    (std::numeric_limits<std::uint64_t>::max() - (kMod - 1))
+      / (static_cast<std::uint64_t>(kMod - 1) * (kMod - 1)));
+  //! Measured with -O3 -march=native on x86-64
+  static constexpr std::size_t kStrassenCutoff = 64;
+
+  static void
+  madd(AccumulatorType& acc, const ModInt<kMod>& a, const ModInt<kMod>& b)
+  {
+    acc += static_cast<std::uint64_t>(a.value()) * b.value();
+  }
+
+  static void
+  reduce(AccumulatorType& acc)
+  {
+    acc %= kMod;
+  }
+
+  static ModInt<kMod>
+  toElement(const AccumulatorType& acc)
+  {
+    return ModInt<kMod>::raw(static_cast<std::uint32_t>(acc % kMod));
+  }
+};  // struct MatrixKernelTraits
+
+
+/*!
+ * @brief Base class of lazily evaluated matrix expressions (CRTP)
+ *
+ * An expression E provides value_type, size_type, getNRow(), getNCol() and
+ * eval(v, i), which stores the value at flat index i into v.
+ * v is either an element or a GCC vector of consecutive elements.
+ *
+ * @tparam E  Type of derived expression
+ */
+template<typename E>
+struct MatrixExpression
+{
+  const E&
+  self() const
+  {
+    return static_cast<const E&>(*this);
+  }
+};  // struct MatrixExpression
+
+
+/*!
+ * @brief How an expression is held in another expression
+ *
+ * Temporary expressions are held by value, and Matrix is held by reference.
+ */
+template<typename E>
+struct MatrixExpressionTraits
+{
+  typedef E StorageType;
+};  // struct MatrixExpressionTraits
+
+
+template<typename ElmType>
+struct MatrixExpressionTraits<Matrix<ElmType> >
+{
+  typedef const Matrix<ElmType>& StorageType;
+};  // struct MatrixExpressionTraits
+
+
+/*!
+ * @brief Whether an expression has a FixedMatrix operand
+ *
+ * Such expressions are as small as the FixedMatrix, so Matrix evaluates them
+ * without SIMD; GCC warns -Warray-bounds on the vector loop otherwise.
+ */
+template<typename E>
+struct HasFixedMatrixOperand :
+  public std::false_type
+{};  // struct HasFixedMatrixOperand
+
+
+struct MatrixAddOp
+{
+  template<typename V>
+  void
+  operator()(V& z, const V& x, const V& y) const
+  {
+    z = x + y;
+  }
+};  // struct MatrixAddOp
+
+
+struct MatrixSubOp
+{
+  template<typename V>
+  void
+  operator()(V& z, const V& x, const V& y) const
+  {
+    z = x - y;
+  }
+};  // struct MatrixSubOp
+
+
+template<typename T>
+struct MatrixMulScalarOp
+{
+  template<typename V>
+  void
+  operator()(V& z, const V& x) const
+  {
+    z = x * value;
+  }
+
+  T value;
+};  // struct MatrixMulScalarOp
+
+
+template<typename T>
+struct MatrixDivScalarOp
+{
+  template<typename V>
+  void
+  operator()(V& z, const V& x) const
+  {
+    z = x / value;
+  }
+
+  T value;
+};  // struct MatrixDivScalarOp
+
+
+/*!
+ * @brief Element-wise binary operation of two matrix expressions
+ */
+template<
+  typename L,
+  typename R,
+  typename Op
+>
+class MatrixBinaryExpression :
+  public MatrixExpression<MatrixBinaryExpression<L, R, Op> >
+{
+  static_assert(std::is_same<typename L::value_type, typename R::value_type>::value, "[MatrixBinaryExpression] Element types of operands must be same");
+
+public:
+  typedef typename L::value_type value_type;
+  typedef std::size_t size_type;
+
+  MatrixBinaryExpression(const L& lhs, const R& rhs, const Op& op = Op())
+    : m_lhs(lhs)
+    , m_rhs(rhs)
+    , m_op(op)
+  {}
+
+  size_type
+  getNRow() const
+  {
+    return m_lhs.getNRow();
+  }
+
+  size_type
+  getNCol() const
+  {
+    return m_lhs.getNCol();
+  }
+
+  template<typename V>
+  void
+  eval(V& v, size_type i) const
+  {
+    V x, y;
+    m_lhs.eval(x, i);
+    m_rhs.eval(y, i);
+    m_op(v, x, y);
+  }
+
+private:
+  typename MatrixExpressionTraits<L>::StorageType m_lhs;
+  typename MatrixExpressionTraits<R>::StorageType m_rhs;
+  Op m_op;
+};  // class MatrixBinaryExpression
+
+
+template<
+  typename L,
+  typename R,
+  typename Op
+>
+struct HasFixedMatrixOperand<MatrixBinaryExpression<L, R, Op> > :
+  public std::integral_constant<bool, HasFixedMatrixOperand<L>::value || HasFixedMatrixOperand<R>::value>
+{};  // struct HasFixedMatrixOperand
+
+
+/*!
+ * @brief Element-wise operation of a matrix expression and a scalar
+ */
+template<
+  typename L,
+  typename Op
+>
+class MatrixScalarExpression :
+  public MatrixExpression<MatrixScalarExpression<L, Op> >
+{
+public:
+  typedef typename L::value_type value_type;
+  typedef std::size_t size_type;
+
+  MatrixScalarExpression(const L& lhs, const Op& op)
+    : m_lhs(lhs)
+    , m_op(op)
+  {}
+
+  size_type
+  getNRow() const
+  {
+    return m_lhs.getNRow();
+  }
+
+  size_type
+  getNCol() const
+  {
+    return m_lhs.getNCol();
+  }
+
+  template<typename V>
+  void
+  eval(V& v, size_type i) const
+  {
+    V x;
+    m_lhs.eval(x, i);
+    m_op(v, x);
+  }
+
+private:
+  typename MatrixExpressionTraits<L>::StorageType m_lhs;
+  Op m_op;
+};  // class MatrixScalarExpression
+
+
+template<
+  typename L,
+  typename Op
+>
+struct HasFixedMatrixOperand<MatrixScalarExpression<L, Op> > :
+  public HasFixedMatrixOperand<L>
+{};  // struct HasFixedMatrixOperand
 
 
 template<typename ElmType>
-class Matrix {
+class Matrix :
+  public MatrixExpression<Matrix<ElmType> >
+{
+  friend class LUDecomposition<ElmType>;
+
 public:
+  typedef ElmType value_type;
   typedef std::size_t size_type;
 private:
   size_type nRow;
   size_type nCol;
-#if __cplusplus >= 201103L
   std::unique_ptr<ElmType[]> data;
+
+  //! Whether ElmType can be an element of GCC vector extension
+  static constexpr bool kIsVectorizable = (std::is_integral<ElmType>::value && !std::is_same<ElmType, bool>::value)
+    || std::is_same<ElmType, float>::value
+    || std::is_same<ElmType, double>::value;
+
+  /*!
+   * @brief z[i] = (value of expression at i) for i in [0, n) in a single pass
+   *
+   * On x86 with GCC/Clang, arithmetic element types are processed with
+   * AVX-512, AVX2 or SSE2 vectors selected by runtime CPU feature detection.
+   * z may be an operand of the expression since each element depends only on
+   * the elements at the same index.
+   * Expressions with a FixedMatrix operand are evaluated element by element.
+   */
+  template<typename E>
+  static void
+  evaluate(ElmType* z, size_type n, const E& e)
+  {
+    evaluate(z, n, e, std::integral_constant<bool, kIsVectorizable && !HasFixedMatrixOperand<E>::value>());
+  }
+
+  template<typename E>
+  static void
+  evaluate(ElmType* z, size_type n, const E& e, std::false_type)
+  {
+    for (size_type i = 0; i < n; i++) {
+      e.eval(z[i], i);
+    }
+  }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  template<typename E>
+  static void
+  evaluate(ElmType* z, size_type n, const E& e, std::true_type)
+  {
+    // evaluateAvx512() is compiled with BW and DQ, so all three are required
+    static const int kLevel = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq") ? 2
+      : __builtin_cpu_supports("avx2") ? 1
+      : 0;
+    switch (kLevel) {
+      case 2:
+        evaluateAvx512(z, n, e);
+        break;
+      case 1:
+        evaluateAvx2(z, n, e);
+        break;
+      default:
+        evaluateVector<16>(z, n, e);
+        break;
+    }
+  }
+
+  template<typename E>
+  __attribute__((target("avx512f,avx512bw,avx512dq")))
+  static void
+  evaluateAvx512(ElmType* z, size_type n, const E& e)
+  {
+    evaluateVector<64>(z, n, e);
+  }
+
+  template<typename E>
+  __attribute__((target("avx2")))
+  static void
+  evaluateAvx2(ElmType* z, size_type n, const E& e)
+  {
+    evaluateVector<32>(z, n, e);
+  }
+
+  template<
+    std::size_t kBytes,
+    typename E
+  >
+  __attribute__((always_inline))
+  static inline void
+  evaluateVector(ElmType* z, size_type n, const E& e)
+  {
+    typedef ElmType V __attribute__((vector_size(kBytes)));
+    static constexpr size_type kStep = kBytes / sizeof(ElmType);
+
+    size_type i = 0;
+    for (; i + kStep <= n; i += kStep) {
+      V v;
+      e.eval(v, i);
+      std::memcpy(z + i, &v, sizeof(V));
+    }
+    for (; i < n; i++) {
+      e.eval(z[i], i);
+    }
+  }
 #else
-  ElmType* data;
-#endif
+  template<typename E>
+  static void
+  evaluate(ElmType* z, size_type n, const E& e, std::true_type)
+  {
+    evaluate(z, n, e, std::false_type());
+  }
+#endif  // defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
 
-  static Matrix<ElmType>
+  template<typename E>
+  void
+  assign(const E& e)
+  {
+    evaluate(data.get(), nRow * nCol, e);
+  }
+
+  static Matrix<ElmType>&
   add(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const Matrix<ElmType>& matY)
   {
-    for (size_type i = 0; i < matZ.nRow; i++) {
-      for (size_type j = 0; j < matZ.nCol; j++) {
-        matZ[i][j] = matX[i][j] + matY[i][j];
-      }
-    }
+    matZ.assign(MatrixBinaryExpression<Matrix<ElmType>, Matrix<ElmType>, MatrixAddOp>(matX, matY));
     return matZ;
   }
 
-  static Matrix<ElmType>
+  static Matrix<ElmType>&
   sub(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const Matrix<ElmType>& matY)
   {
-    for (size_type i = 0; i < matZ.nRow; i++) {
-      for (size_type j = 0; j < matZ.nCol; j++) {
-        matZ[i][j] = matX[i][j] - matY[i][j];
+    matZ.assign(MatrixBinaryExpression<Matrix<ElmType>, Matrix<ElmType>, MatrixSubOp>(matX, matY));
+    return matZ;
+  }
+
+  //! Number of rows of micro kernel
+  static constexpr size_type kMr = 4;
+  //! Number of columns of micro kernel
+  static constexpr size_type kNr = 8;
+  //! Number of rows of a block of left matrix which fits in L2 cache
+  static constexpr size_type kMc = 128;
+  //! Depth of blocks which fits a kKc x kNr panel in L1 cache
+  static constexpr size_type kKc = 256;
+  //! Number of columns of a block of right matrix which fits in L3 cache
+  static constexpr size_type kNc = 4096;
+
+  /*!
+   * @brief Pack a mc x kc block of A into kMr-row slivers, column-major in each sliver
+   *
+   * Rows out of the block are padded with zero.
+   */
+  static void
+  packA(ElmType* packed, const ElmType* a, size_type lda, size_type mc, size_type kc)
+  {
+    for (size_type i = 0; i < mc; i += kMr) {
+      const auto mr = std::min(kMr, mc - i);
+      for (size_type p = 0; p < kc; p++) {
+        for (size_type ii = 0; ii < mr; ii++) {
+          *packed++ = a[(i + ii) * lda + p];
+        }
+        for (size_type ii = mr; ii < kMr; ii++) {
+          *packed++ = ElmType();
+        }
       }
     }
-    return matZ;
   }
 
-  static Matrix<ElmType>
-  mul(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const Matrix<ElmType>& matY)
+  /*!
+   * @brief Pack a kc x nc block of B into kNr-column slivers, row-major in each sliver
+   *
+   * Columns out of the block are padded with zero.
+   */
+  static void
+  packB(ElmType* packed, const ElmType* b, size_type ldb, size_type kc, size_type nc)
   {
-    for (size_type i = 0; i < matZ.nRow; i++) {
-      for (size_type k = 0; k < matX.col; k++) {
-        ElmType p = 0;
-        for (size_type j = 0; j < matZ.nCol; j++) {
-          p += matX[j][k] * matY[k][j];
+    for (size_type j = 0; j < nc; j += kNr) {
+      const auto nr = std::min(kNr, nc - j);
+      for (size_type p = 0; p < kc; p++) {
+        const auto row = b + p * ldb + j;
+        for (size_type jj = 0; jj < nr; jj++) {
+          *packed++ = row[jj];
+        }
+        for (size_type jj = nr; jj < kNr; jj++) {
+          *packed++ = ElmType();
         }
-        matZ[i][j] = p;
       }
     }
-    return matZ;
   }
 
-  static Matrix<ElmType>
-  mul(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const ElmType& y)
+  /*!
+   * @brief C[0:mr, 0:nr] += A' * B' where A' and B' are packed slivers
+   *
+   * Accumulators are kept in a local kMr x kNr array, which compilers keep in
+   * (vector) registers.
+   */
+  static void
+  microKernel(size_type kc, const ElmType* a, const ElmType* b, ElmType* c, size_type ldc, size_type mr, size_type nr)
   {
-    for (size_type i = 0; i < matZ.nRow; i++) {
-      for (size_type j = 0; j < matZ.nCol; j++) {
-        matZ[i][j] = matX[i][j] * y;
+    typedef MatrixKernelTraits<ElmType> Traits;
+
+    typename Traits::AccumulatorType ab[kMr][kNr];
+    for (size_type i = 0; i < kMr; i++) {
+      for (size_type j = 0; j < kNr; j++) {
+        ab[i][j] = typename Traits::AccumulatorType();
+      }
+    }
+    const size_type interval = Traits::kReduceInterval == 0 ? kc : static_cast<size_type>(Traits::kReduceInterval);
+    for (size_type p0 = 0; p0 < kc; p0 += interval) {
+      const auto pEnd = std::min(kc, p0 + interval);
+      for (size_type p = p0; p < pEnd; p++) {
+        for (size_type i = 0; i < kMr; i++) {
+          const auto ai = a[i];
+          for (size_type j = 0; j < kNr; j++) {
+            Traits::madd(ab[i][j], ai, b[j]);
+          }
+        }
+        a += kMr;
+        b += kNr;
+      }
+      if (Traits::kReduceInterval != 0) {
+        for (size_type i = 0; i < kMr; i++) {
+          for (size_type j = 0; j < kNr; j++) {
+            Traits::reduce(ab[i][j]);
+          }
+        }
       }
     }
+    for (size_type i = 0; i < mr; i++) {
+      for (size_type j = 0; j < nr; j++) {
+        c[i * ldc + j] += Traits::toElement(ab[i][j]);
+      }
+    }
+  }
+
+  /*!
+   * @brief C[0:mc, 0:nc] += A' * B' where A' and B' are packed blocks
+   */
+  static void
+  macroKernel(size_type mc, size_type nc, size_type kc, const ElmType* packedA, const ElmType* packedB, ElmType* c, size_type ldc)
+  {
+    for (size_type j = 0; j < nc; j += kNr) {
+      const auto nr = std::min(kNr, nc - j);
+      for (size_type i = 0; i < mc; i += kMr) {
+        const auto mr = std::min(kMr, mc - i);
+        microKernel(kc, packedA + i * kc, packedB + j * kc, c + i * ldc + j, ldc, mr, nr);
+      }
+    }
+  }
+
+  //! Number of elements of the packed A buffer of gemm() for m x k A
+  static size_type
+  packedASize(size_type m, size_type k) noexcept
+  {
+    return (std::min(m, kMc) + kMr - 1) / kMr * kMr * std::min(k, kKc);
+  }
+
+  //! Number of elements of the packed B buffer of gemm() for k x n B
+  static size_type
+  packedBSize(size_type k, size_type n) noexcept
+  {
+    return std::min(k, kKc) * ((std::min(n, kNc) + kNr - 1) / kNr * kNr);
+  }
+
+  /*!
+   * @brief C += A * B, where A is m x k, B is k x n and C is m x n (all row-major)
+   *
+   * Goto/BLIS style cache blocking with packed panels.
+   * packedA and packedB are caller-owned buffers of at least packedASize(m, k)
+   * and packedBSize(k, n) elements.
+   */
+  static void
+  gemm(size_type m, size_type n, size_type k, const ElmType* a, size_type lda, const ElmType* b, size_type ldb, ElmType* c, size_type ldc, ElmType* packedA, ElmType* packedB)
+  {
+    for (size_type jc = 0; jc < n; jc += kNc) {
+      const auto nc = std::min(kNc, n - jc);
+      for (size_type pc = 0; pc < k; pc += kKc) {
+        const auto kc = std::min(kKc, k - pc);
+        packB(packedB, b + pc * ldb + jc, ldb, kc, nc);
+        for (size_type ic = 0; ic < m; ic += kMc) {
+          const auto mc = std::min(kMc, m - ic);
+          packA(packedA, a + ic * lda + pc, lda, mc, kc);
+          macroKernel(mc, nc, kc, packedA, packedB, c + ic * ldc + jc, ldc);
+        }
+      }
+    }
+  }
+
+  /*!
+   * @brief C += A * B with packing buffers allocated for this call
+   */
+  static void
+  gemm(size_type m, size_type n, size_type k, const ElmType* a, size_type lda, const ElmType* b, size_type ldb, ElmType* c, size_type ldc)
+  {
+    std::unique_ptr<ElmType[]> packedA(new ElmType[packedASize(m, k)]);
+    std::unique_ptr<ElmType[]> packedB(new ElmType[packedBSize(k, n)]);
+    gemm(m, n, k, a, lda, b, ldb, c, ldc, packedA.get(), packedB.get());
+  }
+
+  /*!
+   * @brief Z = X * Y for kN x kN matrices
+   *
+   * All loops have compile-time trip counts, so compilers unroll them fully.
+   */
+  template<size_type kN>
+  static void
+  mulFixed(ElmType* z, const ElmType* x, const ElmType* y)
+  {
+    typedef MatrixKernelTraits<ElmType> Traits;
+
+    for (size_type i = 0; i < kN; i++) {
+      for (size_type j = 0; j < kN; j++) {
+        typename Traits::AccumulatorType p = typename Traits::AccumulatorType();
+        for (size_type k = 0; k < kN; k++) {
+          Traits::madd(p, x[i * kN + k], y[k * kN + j]);
+          if (Traits::kReduceInterval != 0 && (k + 1) % Traits::kReduceInterval == 0) {
+            Traits::reduce(p);
+          }
+        }
+        z[i * kN + j] = Traits::toElement(p);
+      }
+    }
+  }
+
+  /*!
+   * @brief Z = X * Y with a specialized kernel if n x n matrices are small
+   * @return Return true if a specialized kernel is used, otherwise false
+   */
+  static bool
+  mulSmallSquare(ElmType* z, const ElmType* x, const ElmType* y, size_type n)
+  {
+    switch (n) {
+      case 2: mulFixed<2>(z, x, y); return true;
+      case 3: mulFixed<3>(z, x, y); return true;
+      case 4: mulFixed<4>(z, x, y); return true;
+      case 5: mulFixed<5>(z, x, y); return true;
+      case 6: mulFixed<6>(z, x, y); return true;
+      case 7: mulFixed<7>(z, x, y); return true;
+      case 8: mulFixed<8>(z, x, y); return true;
+      default: return false;
+    }
+  }
+
+  static Matrix<ElmType>&
+  mul(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const Matrix<ElmType>& matY)
+  {
+    assert(matX.nCol == matY.nRow && matZ.nRow == matX.nRow && matZ.nCol == matY.nCol);
+    assert(&matZ != &matX && &matZ != &matY);
+    if (matX.nRow == matX.nCol && matY.nRow == matY.nCol
+        && mulSmallSquare(matZ.data.get(), matX.data.get(), matY.data.get(), matX.nRow)) {
+      return matZ;
+    }
+    std::fill_n(matZ.data.get(), matZ.nRow * matZ.nCol, ElmType());
+    gemm(matX.nRow, matY.nCol, matX.nCol, matX.data.get(), matX.nCol, matY.data.get(), matY.nCol, matZ.data.get(), matZ.nCol);
     return matZ;
   }
 
-  static Matrix<ElmType>
-  div(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const ElmType& y)
+  /*!
+   * @brief Z = X * Y for n x n matrices with caller-owned packing buffers of gemm()
+   */
+  static Matrix<ElmType>&
+  mulSquare(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const Matrix<ElmType>& matY, ElmType* packedA, ElmType* packedB)
   {
-    for (size_type i = 0; i < matZ.nRow; i++) {
-      for (size_type j = 0; j < matZ.nCol; j++) {
-        matZ[i][j] = matX[i][j] / y;
+    const auto n = matX.nRow;
+    assert(matX.nCol == n && matY.nRow == n && matY.nCol == n && matZ.nRow == n && matZ.nCol == n);
+    assert(&matZ != &matX && &matZ != &matY);
+    if (mulSmallSquare(matZ.data.get(), matX.data.get(), matY.data.get(), n)) {
+      return matZ;
+    }
+    std::fill_n(matZ.data.get(), n * n, ElmType());
+    gemm(n, n, n, matX.data.get(), n, matY.data.get(), n, matZ.data.get(), n, packedA, packedB);
+    return matZ;
+  }
+
+  /*!
+   * @brief Z = X * Y where tiles of Z are computed on multiple threads
+   *
+   * Z is split along its longer side in units of GEMM blocks,
+   * and each thread runs the blocked GEMM on its own tiles.
+   */
+  static Matrix<ElmType>&
+  mul(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const Matrix<ElmType>& matY, const ParallelPolicy& policy)
+  {
+    assert(matX.nCol == matY.nRow && matZ.nRow == matX.nRow && matZ.nCol == matY.nCol);
+    assert(&matZ != &matX && &matZ != &matY);
+    const auto m = matX.nRow;
+    const auto n = matY.nCol;
+    const auto k = matX.nCol;
+    const auto a = matX.data.get();
+    const auto b = matY.data.get();
+    const auto c = matZ.data.get();
+    std::fill_n(c, m * n, ElmType());
+    if (m >= n) {
+      parallelForChunk(m, kMc, policy, [=](unsigned int, size_type first, size_type last) {
+        gemm(last - first, n, k, a + first * k, k, b, n, c + first * n, n);
+      });
+    } else {
+      parallelForChunk(n, kNr, policy, [=](unsigned int, size_type first, size_type last) {
+        gemm(m, last - first, k, a, k, b + first, n, c + first, n);
+      });
+    }
+    return matZ;
+  }
+
+  ElmType
+  det(std::false_type) const
+  {
+    return lu().det();
+  }
+
+  /*!
+   * @brief Determinant by Bareiss algorithm for signed integers, every division is exact
+   *
+   * Each step computes a[i][j] * pivot - aik * a[k][j], where all four
+   * values are minors of this matrix, so the intermediate is a difference
+   * of products of two minors.
+   */
+  ElmType
+  det(std::true_type) const
+  {
+    assert(nRow == nCol);
+    const auto n = nRow;
+    Matrix<ElmType> a(*this);
+    ElmType sign = 1;
+    ElmType prev = 1;
+    for (size_type k = 0; k < n; k++) {
+      if (a[k][k] == 0) {
+        auto p = k + 1;
+        for (; p < n && a[p][k] == 0; p++);
+        if (p == n) {
+          return 0;
+        }
+        std::swap_ranges(a[k], a[k] + n, a[p]);
+        sign = -sign;
+      }
+      const auto pivot = a[k][k];
+      for (auto i = k + 1; i < n; i++) {
+        const auto aik = a[i][k];
+        for (auto j = k + 1; j < n; j++) {
+          a[i][j] = (a[i][j] * pivot - aik * a[k][j]) / prev;
+        }
+      }
+      prev = pivot;
+    }
+    return n == 0 ? 1 : sign * a[n - 1][n - 1];
+  }
+
+  /*!
+   * @brief Size below which Strassen-Winograd recursion falls back to the blocked GEMM
+   *
+   * MatrixKernelTraits<ElmType>::kStrassenCutoff, or 128 for floating point,
+   * which is the best cutoff of double on the same machine.
+   */
+  static constexpr size_type kStrassenCutoff = MatrixKernelTraits<ElmType>::kStrassenCutoff != 0 ? MatrixKernelTraits<ElmType>::kStrassenCutoff : 128;
+
+  /*!
+   * @brief Z = X + Y for n x n blocks
+   */
+  static void
+  addBlock(size_type n, const ElmType* x, size_type ldx, const ElmType* y, size_type ldy, ElmType* z, size_type ldz)
+  {
+    for (size_type i = 0; i < n; i++) {
+      for (size_type j = 0; j < n; j++) {
+        z[i * ldz + j] = x[i * ldx + j] + y[i * ldy + j];
+      }
+    }
+  }
+
+  /*!
+   * @brief Z = X - Y for n x n blocks
+   */
+  static void
+  subBlock(size_type n, const ElmType* x, size_type ldx, const ElmType* y, size_type ldy, ElmType* z, size_type ldz)
+  {
+    for (size_type i = 0; i < n; i++) {
+      for (size_type j = 0; j < n; j++) {
+        z[i * ldz + j] = x[i * ldx + j] - y[i * ldy + j];
       }
     }
+  }
+
+  /*!
+   * @brief Number of elements of the temporaries of strassen() for n x n blocks
+   */
+  static size_type
+  strassenWorkspaceSize(size_type n, size_type cutoff) noexcept
+  {
+    size_type size = 0;
+    for (; n > cutoff && n % 2 == 0; n /= 2) {
+      size += 2 * (n / 2) * (n / 2);
+    }
+    return size;
+  }
+
+  /*!
+   * @brief C = A * B for n x n blocks by Strassen-Winograd recursion
+   *
+   * Uses the schedule of Boyer, Dumas, Pernet and Zhou, which needs only
+   * two temporaries of half size per level.
+   * They are taken from work, which has strassenWorkspaceSize(n, cutoff)
+   * elements, and packedA and packedB are the packing buffers of gemm()
+   * for n x n blocks, so the recursion does not allocate.
+   */
+  static void
+  strassen(size_type n, const ElmType* a, size_type lda, const ElmType* b, size_type ldb, ElmType* c, size_type ldc, size_type cutoff, ElmType* work, ElmType* packedA, ElmType* packedB)
+  {
+    if (n <= cutoff || n % 2 != 0) {
+      for (size_type i = 0; i < n; i++) {
+        std::fill_n(c + i * ldc, n, ElmType());
+      }
+      gemm(n, n, n, a, lda, b, ldb, c, ldc, packedA, packedB);
+      return;
+    }
+    const auto h = n / 2;
+    const auto a11 = a;
+    const auto a12 = a + h;
+    const auto a21 = a + h * lda;
+    const auto a22 = a + h * lda + h;
+    const auto b11 = b;
+    const auto b12 = b + h;
+    const auto b21 = b + h * ldb;
+    const auto b22 = b + h * ldb + h;
+    const auto c11 = c;
+    const auto c12 = c + h;
+    const auto c21 = c + h * ldc;
+    const auto c22 = c + h * ldc + h;
+    const auto x = work;
+    const auto y = work + h * h;
+    const auto next = work + 2 * h * h;
+
+    subBlock(h, a11, lda, a21, lda, x, h);    // S3 = A11 - A21
+    subBlock(h, b22, ldb, b12, ldb, y, h);    // T3 = B22 - B12
+    strassen(h, x, h, y, h, c21, ldc, cutoff, next, packedA, packedB);  // P7 = S3 * T3
+    addBlock(h, a21, lda, a22, lda, x, h);    // S1 = A21 + A22
+    subBlock(h, b12, ldb, b11, ldb, y, h);    // T1 = B12 - B11
+    strassen(h, x, h, y, h, c22, ldc, cutoff, next, packedA, packedB);  // P5 = S1 * T1
+    subBlock(h, x, h, a11, lda, x, h);        // S2 = S1 - A11
+    subBlock(h, b22, ldb, y, h, y, h);        // T2 = B22 - T1
+    strassen(h, x, h, y, h, c12, ldc, cutoff, next, packedA, packedB);  // P6 = S2 * T2
+    subBlock(h, a12, lda, x, h, x, h);        // S4 = A12 - S2
+    strassen(h, x, h, b22, ldb, c11, ldc, cutoff, next, packedA, packedB);  // P3 = S4 * B22
+    strassen(h, a11, lda, b11, ldb, x, h, cutoff, next, packedA, packedB);  // P1 = A11 * B11
+    addBlock(h, x, h, c12, ldc, c12, ldc);    // U2 = P1 + P6
+    addBlock(h, c12, ldc, c21, ldc, c21, ldc);  // U3 = U2 + P7
+    addBlock(h, c12, ldc, c22, ldc, c12, ldc);  // U4 = U2 + P5
+    addBlock(h, c21, ldc, c22, ldc, c22, ldc);  // U7 = U3 + P5
+    addBlock(h, c12, ldc, c11, ldc, c12, ldc);  // U5 = U4 + P3
+    subBlock(h, y, h, b21, ldb, y, h);        // T4 = T2 - B21
+    strassen(h, a22, lda, y, h, c11, ldc, cutoff, next, packedA, packedB);  // P4 = A22 * T4
+    subBlock(h, c21, ldc, c11, ldc, c21, ldc);  // U6 = U3 - P4
+    strassen(h, a12, lda, b21, ldb, c11, ldc, cutoff, next, packedA, packedB);  // P2 = A12 * B21
+    addBlock(h, x, h, c11, ldc, c11, ldc);    // U1 = P1 + P2
+  }
+
+  //! Size of square tiles of transpose, which fit in L1 cache
+  static constexpr size_type kTransposeBlock = 32;
+
+  /*!
+   * @brief Transpose rows [first, last) of X into columns of Z tile by tile
+   */
+  static void
+  transposeRows(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, size_type first, size_type last)
+  {
+    const auto x = matX.data.get();
+    const auto z = matZ.data.get();
+    const auto nRowX = matX.nRow;
+    const auto nColX = matX.nCol;
+    for (size_type i0 = first; i0 < last; i0 += kTransposeBlock) {
+      const auto i1 = std::min(last, i0 + kTransposeBlock);
+      for (size_type j0 = 0; j0 < nColX; j0 += kTransposeBlock) {
+        const auto j1 = std::min(nColX, j0 + kTransposeBlock);
+        for (size_type i = i0; i < i1; i++) {
+          for (size_type j = j0; j < j1; j++) {
+            z[j * nRowX + i] = x[i * nColX + j];
+          }
+        }
+      }
+    }
+  }
+
+  static Matrix<ElmType>&
+  mul(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const ElmType& y)
+  {
+    matZ.assign(MatrixScalarExpression<Matrix<ElmType>, MatrixMulScalarOp<ElmType>>(matX, MatrixMulScalarOp<ElmType>{y}));
+    return matZ;
+  }
+
+  static Matrix<ElmType>&
+  div(Matrix<ElmType>& matZ, const Matrix<ElmType>& matX, const ElmType& y)
+  {
+    matZ.assign(MatrixScalarExpression<Matrix<ElmType>, MatrixDivScalarOp<ElmType>>(matX, MatrixDivScalarOp<ElmType>{y}));
     return matZ;
   }
 
@@ -85,6 +920,7 @@ public:
   Identity(size_type nRowCol)
   {
     Matrix<ElmType> iMat(nRowCol, nRowCol);
+    iMat.fill(ElmType());
     for (size_type i = 0; i < nRowCol; i++) {
       iMat[i][i] = 1;
     }
@@ -95,295 +931,989 @@ public:
     nRow(nRow), nCol(nCol), data(new ElmType[nRow * nCol])
   {}
 
-  Matrix(const Matrix<ElmType>& that) :
-    nRow(that.nRow), nCol(that.nCol), data(new ElmType[nRow * nCol])
+  Matrix(const Matrix<ElmType>& that) :
+    nRow(that.nRow), nCol(that.nCol), data(new ElmType[nRow * nCol])
+  {
+    std::copy_n(that.data.get(), nRow * nCol, data.get());
+  }
+
+  Matrix(Matrix<ElmType>&& that) noexcept :
+    nRow(that.nRow), nCol(that.nCol), data(std::move(that.data))
+  {
+    that.nRow = 0;
+    that.nCol = 0;
+  }
+
+  template<typename E>
+  Matrix(const MatrixExpression<E>& that) :
+    nRow(that.self().getNRow()), nCol(that.self().getNCol()), data(new ElmType[nRow * nCol])
+  {
+    assign(that.self());
+  }
+
+  void
+  fill(const ElmType& value)
+  {
+    std::fill_n(data.get(), nRow * nCol, value);
+  }
+
+  Matrix<ElmType>
+  add(const Matrix<ElmType>& that) const
+  {
+    assert(this->nRow == that.nRow && this->nCol == that.nCol);
+    Matrix<ElmType> result(this->nRow, this->nCol);
+    add(result, *this, that);
+    return result;
+  }
+
+  Matrix<ElmType>&
+  add_(const Matrix<ElmType>& that)
+  {
+    assert(this->nRow == that.nRow && this->nCol == that.nCol);
+    return add(*this, *this, that);
+  }
+
+  Matrix<ElmType>
+  sub(const Matrix<ElmType>& that) const
+  {
+    assert(this->nRow == that.nRow && this->nCol == that.nCol);
+    Matrix<ElmType> result(this->nRow, this->nCol);
+    sub(result, *this, that);
+    return result;
+  }
+
+  Matrix<ElmType>&
+  sub_(const Matrix<ElmType>& that)
+  {
+    assert(this->nRow == that.nRow && this->nCol == that.nCol);
+    return sub(*this, *this, that);
+  }
+
+  /*!
+   * @brief Matrix product
+   *
+   * Square operands larger than MatrixKernelTraits<ElmType>::kStrassenCutoff
+   * are multiplied by mulStrassen(), others by the blocked GEMM.
+   *
+   * @param [in] that  Right operand
+   * @return Product of this and that
+   */
+  Matrix<ElmType>
+  mul(const Matrix<ElmType>& that) const
+  {
+    assert(this->nCol == that.nRow);
+    const auto n = this->nRow;
+    if (MatrixKernelTraits<ElmType>::kStrassenCutoff != 0 && n == this->nCol && n == that.nCol
+        && n > MatrixKernelTraits<ElmType>::kStrassenCutoff) {
+      return mulStrassen(that);
+    }
+    Matrix<ElmType> result(this->nRow, that.nCol);
+    mul(result, *this, that);
+    return result;
+  }
+
+  /*!
+   * @brief Matrix product by Strassen-Winograd algorithm, O(n^2.81)
+   *
+   * Intended for large square matrices of integer or modular elements;
+   * floating point results are less accurate than mul().
+   * The matrices are padded so that the recursion halves down to cutoff,
+   * and non-square operands or operands not larger than cutoff are
+   * multiplied by the blocked GEMM.
+   *
+   * @param [in] that    Right operand
+   * @param [in] cutoff  Size at which the recursion switches to the blocked GEMM
+   * @return Product of this and that
+   */
+  Matrix<ElmType>
+  mulStrassen(const Matrix<ElmType>& that, size_type cutoff = kStrassenCutoff) const
+  {
+    assert(this->nCol == that.nRow);
+    const auto n = this->nRow;
+    if (n != this->nCol || n != that.nCol || n <= cutoff) {
+      Matrix<ElmType> result(this->nRow, that.nCol);
+      mul(result, *this, that);
+      return result;
+    }
+    auto padded = n;
+    size_type scale = 1;
+    for (; (padded + scale - 1) / scale > cutoff; scale <<= 1);
+    padded = (n + scale - 1) / scale * scale;
+
+    std::unique_ptr<ElmType[]> work(new ElmType[strassenWorkspaceSize(padded, cutoff)]);
+    std::unique_ptr<ElmType[]> packedA(new ElmType[packedASize(padded, padded)]);
+    std::unique_ptr<ElmType[]> packedB(new ElmType[packedBSize(padded, padded)]);
+    Matrix<ElmType> result(n, n);
+    if (padded == n) {
+      strassen(n, this->data.get(), n, that.data.get(), n, result.data.get(), n, cutoff, work.get(), packedA.get(), packedB.get());
+      return result;
+    }
+    Matrix<ElmType> x(padded, padded);
+    Matrix<ElmType> y(padded, padded);
+    Matrix<ElmType> z(padded, padded);
+    x.fill(ElmType());
+    y.fill(ElmType());
+    for (size_type i = 0; i < n; i++) {
+      std::copy_n((*this)[i], n, x[i]);
+      std::copy_n(that[i], n, y[i]);
+    }
+    strassen(padded, x.data.get(), padded, y.data.get(), padded, z.data.get(), padded, cutoff, work.get(), packedA.get(), packedB.get());
+    for (size_type i = 0; i < n; i++) {
+      std::copy_n(z[i], n, result[i]);
+    }
+    return result;
+  }
+
+  Matrix<ElmType>
+  mul(const Matrix<ElmType>& that, const ParallelPolicy& policy) const
+  {
+    assert(this->nCol == that.nRow);
+    Matrix<ElmType> result(this->nRow, that.nCol);
+    mul(result, *this, that, policy);
+    return result;
+  }
+
+  Matrix<ElmType>
+  mul(const ElmType& that) const
+  {
+    Matrix<ElmType> result(this->nRow, this->nCol);
+    mul(result, *this, that);
+    return result;
+  }
+
+  Matrix<ElmType>&
+  mul_(const Matrix<ElmType>& that)
+  {
+    return *this = mul(that);
+  }
+
+  Matrix<ElmType>&
+  mul_(const ElmType& that)
+  {
+    return mul(*this, *this, that);
+  }
+
+  Matrix<ElmType>
+  div(const ElmType& that) const
+  {
+    Matrix<ElmType> result(this->nRow, this->nCol);
+    div(result, *this, that);
+    return result;
+  }
+
+  Matrix<ElmType>&
+  div_(const ElmType& that)
+  {
+    return div(*this, *this, that);
+  }
+
+  /*!
+   * @brief Calculate n-th power by binary exponentiation
+   *
+   * O(log n) multiplications which ping-pong between three buffers and
+   * share one pair of packing buffers, so no allocation happens in the loop.
+   */
+  Matrix<ElmType>
+  pow(unsigned long long n) const
+  {
+    assert(this->nRow == this->nCol);
+    const auto size = this->nRow;
+    Matrix<ElmType> result = Identity(size);
+    Matrix<ElmType> base(*this);
+    Matrix<ElmType> tmp(size, size);
+    std::unique_ptr<ElmType[]> packedA(new ElmType[packedASize(size, size)]);
+    std::unique_ptr<ElmType[]> packedB(new ElmType[packedBSize(size, size)]);
+    for (; n > 0; n >>= 1) {
+      if ((n & 1) != 0) {
+        mulSquare(tmp, result, base, packedA.get(), packedB.get());
+        std::swap(result, tmp);
+      }
+      if (n > 1) {
+        mulSquare(tmp, base, base, packedA.get(), packedB.get());
+        std::swap(base, tmp);
+      }
+    }
+    return result;
+  }
+
+  /*!
+   * @brief LU decomposition with partial pivoting, which can be reused for det(), inverse() and solve()
+   * @return LU decomposition of this matrix
+   */
+  LUDecomposition<ElmType>
+  lu() const
+  {
+    return LUDecomposition<ElmType>(*this);
+  }
+
+  /*!
+   * @brief Calculate determinant
+   *
+   * Signed integer matrices use fraction-free Bareiss elimination, so the
+   * result is exact as long as a difference of two products of two minors
+   * fits in ElmType (e.g. twice the square of the largest absolute minor);
+   * note that this overflows long before the determinant itself does.
+   * Others use LU decomposition; unsigned integers are not supported.
+   *
+   * @return Determinant of this matrix
+   */
+  ElmType
+  det() const
+  {
+    static_assert(!std::is_integral<ElmType>::value || std::is_signed<ElmType>::value, "[Matrix] Determinant of unsigned integers is not supported");
+    return det(std::integral_constant<bool, std::is_integral<ElmType>::value && std::is_signed<ElmType>::value>());
+  }
+
+  /*!
+   * @brief Solve this * X = B
+   * @param [in] b  Right-hand sides (nRow x k)
+   * @return X (nCol x k)
+   */
+  Matrix<ElmType>
+  solve(const Matrix<ElmType>& b) const
+  {
+    return lu().solve(b);
+  }
+
+  Matrix<ElmType>
+  transpose() const
+  {
+    Matrix<ElmType> tMat(this->nCol, this->nRow);
+    transposeRows(tMat, *this, 0, nRow);
+    return tMat;
+  }
+
+  Matrix<ElmType>
+  transpose(const ParallelPolicy& policy) const
+  {
+    Matrix<ElmType> tMat(this->nCol, this->nRow);
+    parallelForChunk(nRow, kTransposeBlock, policy, [&tMat, this](unsigned int, size_type first, size_type last) {
+      transposeRows(tMat, *this, first, last);
+    });
+    return tMat;
+  }
+
+  /*!
+   * @brief Calculate inverse matrix
+   * @return Inverse matrix, or zero matrix if this matrix is singular
+   */
+  Matrix<ElmType>
+  inverse() const
+  {
+    return lu().inverse();
+  }
+
+  ElmType&
+  at(size_type y, size_type x) const
+  {
+    assert(y < nRow && x < nCol);
+    return data[y * nCol + x];
+  }
+
+  size_type
+  getNRow() const
+  {
+    return nRow;
+  }
+
+  size_type
+  getNCol() const
+  {
+    return nCol;
+  }
+
+  template<typename E>
+  Matrix<ElmType>&
+  operator+=(const MatrixExpression<E>& that)
   {
-    std::memcpy(data, that.data, nRow * nCol * sizeof(ElmType));
+    assert(this->nRow == that.self().getNRow() && this->nCol == that.self().getNCol());
+    assign(MatrixBinaryExpression<Matrix<ElmType>, E, MatrixAddOp>(*this, that.self()));
+    return *this;
   }
 
-#if __cplusplus < 201103L
-  ~Matrix()
+  template<typename E>
+  Matrix<ElmType>&
+  operator-=(const MatrixExpression<E>& that)
   {
-    delete[] data;
+    assert(this->nRow == that.self().getNRow() && this->nCol == that.self().getNCol());
+    assign(MatrixBinaryExpression<Matrix<ElmType>, E, MatrixSubOp>(*this, that.self()));
+    return *this;
   }
-#endif
 
-  void
-  fill(const ElmType& value)
+  Matrix<ElmType>&
+  operator*=(const Matrix<ElmType>& that)
   {
-    std::fill_n(data, nRow * nCol, value);
+    return this->mul_(that);
   }
 
-  Matrix<ElmType>
-  add(const Matrix<ElmType>& that) const
+  Matrix<ElmType>&
+  operator*=(const ElmType& that)
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    Matrix<ElmType> result(this->nRow, this->nCol);
-    return add(result, *this, that);
+    return this->mul_(that);
   }
 
-  Matrix<ElmType>
-  add_(const Matrix<ElmType>& that)
+  Matrix<ElmType>&
+  operator/=(const ElmType& that)
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    return add(*this, *this, that);
+    return this->div_(that);
   }
 
-  Matrix<ElmType>
-  sub(const Matrix<ElmType>& that) const
+  ElmType*
+  operator[](size_type row) const
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    Matrix<ElmType> result(this->nRow, this->nCol);
-    return sub(result, *this, that);
+    return &data[row * nCol];
   }
 
-  Matrix<ElmType>
-  sub_(const Matrix<ElmType>& that)
+  template<typename E>
+  Matrix<ElmType>&
+  operator=(const MatrixExpression<E>& that)
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    return sub(*this, *this, that);
+    const auto& e = that.self();
+    if (nRow != e.getNRow() || nCol != e.getNCol()) {
+      return *this = Matrix<ElmType>(e);
+    }
+    assign(e);
+    return *this;
   }
 
-  Matrix<ElmType>
-  mul(const Matrix<ElmType>& that) const
+  void
+  eval(ElmType& v, size_type i) const
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    Matrix<ElmType> result(this->nRow, this->nCol);
-    return mul(result, *this, that);
+    v = data[i];
   }
 
-  Matrix<ElmType>
-  mul(const ElmType& that) const
+  template<typename V>
+  void
+  eval(V& v, size_type i) const
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    Matrix<ElmType> result(this->nRow, this->nCol);
-    return mul(result, *this, that);
+    std::memcpy(&v, &data[i], sizeof(V));
   }
 
-  Matrix<ElmType>
-  mul_(const Matrix<ElmType>& that)
+  Matrix<ElmType>&
+  operator=(const Matrix<ElmType>& that)
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    Matrix<ElmType> result(this->nRow, this->nCol);
-    mul(result, *this, that);
-    *this = result;
+    if (this == &that) {
+      return *this;
+    }
+    if (nRow * nCol != that.nRow * that.nCol) {
+      data.reset(new ElmType[that.nRow * that.nCol]);
+    }
+    nRow = that.nRow;
+    nCol = that.nCol;
+    std::copy_n(that.data.get(), nRow * nCol, data.get());
     return *this;
   }
 
-  Matrix<ElmType>
-  mul_(const ElmType& that)
+  Matrix<ElmType>&
+  operator=(Matrix<ElmType>&& that) noexcept
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    return mul(*this, *this, that);
+    nRow = that.nRow;
+    nCol = that.nCol;
+    data = std::move(that.data);
+    that.nRow = 0;
+    that.nCol = 0;
+    return *this;
   }
 
-  Matrix<ElmType>
-  div(const ElmType& that) const
+  template<typename CharT, typename Traits>
+  friend std::basic_ostream<CharT, Traits>&
+  operator<<(std::basic_ostream<CharT, Traits>& os, const Matrix<ElmType>& this_)
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    Matrix<ElmType> result(this->nRow, this->nCol);
-    return div(result, *this, that);
+    os << "{\n";
+    for (size_type i = 0; i < this_.nRow; i++) {
+      os << "  {";
+      for (size_type j = 0, jMax = this_.nCol - 1; j < jMax; j++) {
+        os << this_[i][j] << ", ";
+      }
+      os << this_[i][this_.nCol - 1] << "}\n";
+    }
+    os << "}";
+    return os;
   }
+};  // class Matrix
 
-  Matrix<ElmType>
-  div_(const ElmType& that)
+
+template<typename ElmType>
+static inline const Matrix<ElmType>&
+evaluateMatrix(const Matrix<ElmType>& mat)
+{
+  return mat;
+}
+
+
+template<typename E>
+static inline Matrix<typename E::value_type>
+evaluateMatrix(const MatrixExpression<E>& e)
+{
+  return Matrix<typename E::value_type>(e);
+}
+
+
+template<
+  typename L,
+  typename R
+>
+static inline MatrixBinaryExpression<L, R, MatrixAddOp>
+operator+(const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+  assert(lhs.self().getNRow() == rhs.self().getNRow() && lhs.self().getNCol() == rhs.self().getNCol());
+  return MatrixBinaryExpression<L, R, MatrixAddOp>(lhs.self(), rhs.self());
+}
+
+
+template<
+  typename L,
+  typename R
+>
+static inline MatrixBinaryExpression<L, R, MatrixSubOp>
+operator-(const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+  assert(lhs.self().getNRow() == rhs.self().getNRow() && lhs.self().getNCol() == rhs.self().getNCol());
+  return MatrixBinaryExpression<L, R, MatrixSubOp>(lhs.self(), rhs.self());
+}
+
+
+/*!
+ * @brief Matrix product, which is evaluated eagerly
+ *
+ * Operands which are not Matrix are evaluated into a temporary Matrix first.
+ */
+template<
+  typename L,
+  typename R
+>
+static inline Matrix<typename L::value_type>
+operator*(const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+  const auto& x = evaluateMatrix(lhs.self());
+  const auto& y = evaluateMatrix(rhs.self());
+  return x.mul(y);
+}
+
+
+template<typename L>
+static inline MatrixScalarExpression<L, MatrixMulScalarOp<typename L::value_type> >
+operator*(const MatrixExpression<L>& lhs, const typename L::value_type& rhs)
+{
+  return MatrixScalarExpression<L, MatrixMulScalarOp<typename L::value_type> >(lhs.self(), MatrixMulScalarOp<typename L::value_type>{rhs});
+}
+
+
+template<typename R>
+static inline MatrixScalarExpression<R, MatrixMulScalarOp<typename R::value_type> >
+operator*(const typename R::value_type& lhs, const MatrixExpression<R>& rhs)
+{
+  return MatrixScalarExpression<R, MatrixMulScalarOp<typename R::value_type> >(rhs.self(), MatrixMulScalarOp<typename R::value_type>{lhs});
+}
+
+
+template<typename L>
+static inline MatrixScalarExpression<L, MatrixDivScalarOp<typename L::value_type> >
+operator/(const MatrixExpression<L>& lhs, const typename L::value_type& rhs)
+{
+  return MatrixScalarExpression<L, MatrixDivScalarOp<typename L::value_type> >(lhs.self(), MatrixDivScalarOp<typename L::value_type>{rhs});
+}
+
+
+template<typename ElmType>
+constexpr typename Matrix<ElmType>::size_type Matrix<ElmType>::kMr;
+template<typename ElmType>
+constexpr typename Matrix<ElmType>::size_type Matrix<ElmType>::kNr;
+template<typename ElmType>
+constexpr typename Matrix<ElmType>::size_type Matrix<ElmType>::kMc;
+template<typename ElmType>
+constexpr typename Matrix<ElmType>::size_type Matrix<ElmType>::kKc;
+template<typename ElmType>
+constexpr typename Matrix<ElmType>::size_type Matrix<ElmType>::kNc;
+template<typename ElmType>
+constexpr typename Matrix<ElmType>::size_type Matrix<ElmType>::kTransposeBlock;
+template<typename ElmType>
+constexpr typename Matrix<ElmType>::size_type Matrix<ElmType>::kStrassenCutoff;
+
+
+
+/*!
+ * @brief Magnitude of a pivot candidate for partial pivoting
+ *
+ * Arithmetic types use the absolute value, and other types
+ * (e.g. ModInt) only distinguish zero and non-zero.
+ */
+template<typename ElmType>
+static inline typename std::enable_if<std::is_arithmetic<ElmType>::value, ElmType>::type
+pivotMagnitude(const ElmType& x)
+{
+  return x < 0 ? -x : x;
+}
+
+
+template<typename ElmType>
+static inline typename std::enable_if<!std::is_arithmetic<ElmType>::value, int>::type
+pivotMagnitude(const ElmType& x)
+{
+  return x == ElmType() ? 0 : 1;
+}
+
+
+/*!
+ * @brief LU decomposition with partial pivoting, PA = LU
+ *
+ * Factor once and solve many: the factorization costs O(n^3) and each
+ * right-hand side costs O(n^2).
+ * The factorization is blocked; trailing submatrices are updated with the
+ * cache-blocked GEMM kernel of Matrix.
+ * ElmType must be a field (e.g. floating point or ModInt), because pivots
+ * are inverted; Matrix::det() handles signed integer matrices separately.
+ *
+ * @tparam ElmType  Type of element
+ */
+template<typename ElmType>
+class LUDecomposition
+{
+  static_assert(!std::is_integral<ElmType>::value, "[LUDecomposition] Integer elements cannot be divided exactly; use floating point or ModInt");
+
+public:
+  typedef std::size_t size_type;
+
+  explicit LUDecomposition(const Matrix<ElmType>& mat)
+    : m_lu(mat)
+    , m_perm(mat.getNRow())
+    , m_isOdd(false)
+    , m_isSingular(false)
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    return div(*this, *this, that);
+    assert(mat.getNRow() == mat.getNCol());
+    for (size_type i = 0; i < m_perm.size(); i++) {
+      m_perm[i] = i;
+    }
+    factorize();
   }
 
-  Matrix<ElmType>
-  pow(size_type n) const
+  bool
+  isSingular() const
   {
-    assert(this->nRow == that.nRow && this->nCol == that.nCol);
-    Matrix<ElmType> result(this->nRow, this->nCol);
-    for (int i = 0; i < n; i++) {
-      mul(result, *this, *this);
-    }
-    return result;
+    return m_isSingular;
   }
 
   ElmType
   det() const
   {
-    assert(this->nRow == this->nCol);
-    for (size_type i = 0; i < this->nRow; i++){
-      for (size_type j = 0; j < this->nCol; j++){
-        if (i < j){
-          ElmType tmp = (*this)[j][i] / (*this)[i][i];
-          for (size_type k = 0; k < this->nRow; k++){
-            (*this)[j][k] -= (*this)[i][k] * tmp;
-          }
-        }
-      }
-    }
+    const auto n = m_lu.getNRow();
     ElmType det = 1;
-    for (size_type i = 0; i < this->nRow; i++){
-      det *= (*this)[i][i];
+    for (size_type i = 0; i < n; i++) {
+      det *= m_lu[i][i];
     }
-    return det;
+    return m_isOdd ? -det : det;
   }
 
+  /*!
+   * @brief Solve A * X = B
+   * @param [in] b  Right-hand sides (n x k)
+   * @return X (n x k), or zero matrix if A is singular
+   */
   Matrix<ElmType>
-  transpose() const
+  solve(const Matrix<ElmType>& b) const
   {
-    Matrix<ElmType> tMat(this->nCol, this->nRow);
-    for (size_type i = 0; i < nRow; i++) {
-      for (size_type j = 0; j < nCol; j++) {
-        tMat[j][i] = (*this)[i][j];
+    const auto n = m_lu.getNRow();
+    const auto k = b.getNCol();
+    assert(b.getNRow() == n);
+
+    Matrix<ElmType> x(n, k);
+    if (m_isSingular) {
+      x.fill(ElmType());
+      return x;
+    }
+    for (size_type i = 0; i < n; i++) {
+      std::copy_n(b[m_perm[i]], k, x[i]);
+    }
+    // Forward substitution with unit lower triangular L
+    for (size_type i = 0; i < n; i++) {
+      const auto xi = x[i];
+      for (size_type p = 0; p < i; p++) {
+        const auto l = m_lu[i][p];
+        const auto xp = x[p];
+        for (size_type j = 0; j < k; j++) {
+          xi[j] -= l * xp[j];
+        }
       }
     }
-    return tMat;
+    // Backward substitution with upper triangular U
+    for (size_type i = n; i-- > 0;) {
+      const auto xi = x[i];
+      for (size_type p = i + 1; p < n; p++) {
+        const auto u = m_lu[i][p];
+        const auto xp = x[p];
+        for (size_type j = 0; j < k; j++) {
+          xi[j] -= u * xp[j];
+        }
+      }
+      const auto d = m_lu[i][i];
+      for (size_type j = 0; j < k; j++) {
+        xi[j] /= d;
+      }
+    }
+    return x;
   }
 
   Matrix<ElmType>
   inverse() const
   {
-    assert(this->nRow == this->nCol);
-    Matrix orgMat = *this;
-    Matrix invMat = Identity(this->nRow);
-    for (size_type i = 0; i < invMat.nRow; i++) {
-      if (orgMat[i][i] == 0) {
-        return Matrix(nRow, nCol);
+    return solve(Matrix<ElmType>::Identity(m_lu.getNRow()));
+  }
+
+private:
+  //! Number of columns of a panel
+  static constexpr size_type kBlockSize = 64;
+
+  void
+  factorize()
+  {
+    const auto n = m_lu.getNRow();
+    ElmType* a = m_lu.data.get();
+    std::unique_ptr<ElmType[]> negL21;
+    for (size_type k0 = 0; k0 < n; k0 += kBlockSize) {
+      const auto kb = std::min(kBlockSize, n - k0);
+      const auto k1 = k0 + kb;
+      // Factorize panel A[k0:n, k0:k1] with partial pivoting
+      for (size_type k = k0; k < k1; k++) {
+        auto p = k;
+        auto maxMagnitude = pivotMagnitude(a[k * n + k]);
+        for (size_type i = k + 1; i < n; i++) {
+          const auto magnitude = pivotMagnitude(a[i * n + k]);
+          if (maxMagnitude < magnitude) {
+            p = i;
+            maxMagnitude = magnitude;
+          }
+        }
+        if (a[p * n + k] == ElmType()) {
+          m_isSingular = true;
+          continue;
+        }
+        if (p != k) {
+          std::swap_ranges(a + p * n, a + (p + 1) * n, a + k * n);
+          std::swap(m_perm[p], m_perm[k]);
+          m_isOdd = !m_isOdd;
+        }
+        const auto inv = ElmType(1) / a[k * n + k];
+        for (size_type i = k + 1; i < n; i++) {
+          const auto l = a[i * n + k] *= inv;
+          for (size_type j = k + 1; j < k1; j++) {
+            a[i * n + j] -= l * a[k * n + j];
+          }
+        }
       }
-      ElmType tmp = 1 / orgMat[i][i];
-      for (size_type j = 0; j < invMat.nRow; j++){
-        orgMat[i][j] *= tmp;
-        invMat[i][j] *= tmp;
+      if (k1 == n) {
+        break;
       }
-      for (size_type j = 0; j < invMat.nRow; j++){
-        if (i != j) {
-          for (size_type k = 0; k < invMat.nRow; k++) {
-            orgMat[j][k] -= orgMat[i][k] * orgMat[j][i];
-            invMat[j][k] -= invMat[i][k] * orgMat[j][i];
+      // U12 = L11^-1 * A12
+      for (size_type k = k0; k < k1; k++) {
+        for (size_type i = k + 1; i < k1; i++) {
+          const auto l = a[i * n + k];
+          for (size_type j = k1; j < n; j++) {
+            a[i * n + j] -= l * a[k * n + j];
           }
         }
       }
+      // A22 -= L21 * U12
+      const auto m = n - k1;
+      if (!negL21) {
+        negL21.reset(new ElmType[m * kBlockSize]);
+      }
+      for (size_type i = 0; i < m; i++) {
+        for (size_type p = 0; p < kb; p++) {
+          negL21[i * kb + p] = -a[(k1 + i) * n + k0 + p];
+        }
+      }
+      Matrix<ElmType>::gemm(m, m, kb, negL21.get(), kb, a + k0 * n + k1, n, a + k1 * n + k1, n);
     }
-    return invMat;
   }
 
-  ElmType&
-  at(size_type y, size_type x) const
+  //! L (strictly lower part, unit diagonal is omitted) and U (upper part)
+  Matrix<ElmType> m_lu;
+  //! Row permutation, row i of PA is row m_perm[i] of A
+  std::vector<size_type> m_perm;
+  //! Whether the permutation is odd
+  bool m_isOdd;
+  //! Whether the matrix is singular
+  bool m_isSingular;
+};  // class LUDecomposition
+
+
+template<typename ElmType>
+constexpr typename LUDecomposition<ElmType>::size_type LUDecomposition<ElmType>::kBlockSize;
+
+
+template<
+  typename ElmType,
+  std::size_t kRow,
+  std::size_t kCol
+>
+class FixedMatrix;
+
+
+template<
+  typename ElmType,
+  std::size_t kRow,
+  std::size_t kCol
+>
+struct MatrixExpressionTraits<FixedMatrix<ElmType, kRow, kCol> >
+{
+  typedef const FixedMatrix<ElmType, kRow, kCol>& StorageType;
+};  // struct MatrixExpressionTraits
+
+
+template<
+  typename ElmType,
+  std::size_t kRow,
+  std::size_t kCol
+>
+struct HasFixedMatrixOperand<FixedMatrix<ElmType, kRow, kCol> > :
+  public std::true_type
+{};  // struct HasFixedMatrixOperand
+
+
+/*!
+ * @brief Matrix whose size is fixed at compile time
+ *
+ * Elements are stored inline (no heap allocation) and aligned for SIMD
+ * loads, and every loop has a compile-time trip count.
+ * FixedMatrix is a matrix expression, so it can be mixed with Matrix in
+ * element-wise expressions and converted from / to Matrix.
+ *
+ * @tparam ElmType  Type of element
+ * @tparam kRow     Number of rows
+ * @tparam kCol     Number of columns
+ */
+template<
+  typename ElmType,
+  std::size_t kRow,
+  std::size_t kCol
+>
+class FixedMatrix :
+  public MatrixExpression<FixedMatrix<ElmType, kRow, kCol> >
+{
+  static_assert(kRow > 0 && kCol > 0, "[FixedMatrix] Size must not be zero");
+
+public:
+  typedef ElmType value_type;
+  typedef std::size_t size_type;
+
+  static constexpr size_type kSize = kRow * kCol;
+  static constexpr size_type kAlignment = alignof(ElmType) > 32 ? alignof(ElmType) : 32;
+
+  static FixedMatrix<ElmType, kRow, kCol>
+  Identity()
   {
-    assert(y < nRow && x < nCol);
-    return data[y * nCol + x];
+    static_assert(kRow == kCol, "[FixedMatrix] Identity matrix must be square");
+    FixedMatrix<ElmType, kRow, kCol> iMat;
+    for (size_type i = 0; i < kRow; i++) {
+      iMat.data[i * kCol + i] = 1;
+    }
+    return iMat;
   }
 
-  size_type
-  getNRow() const
+  FixedMatrix()
   {
-    return nRow;
+    fill(ElmType());
   }
 
-  size_type
-  getNCol() const
+  FixedMatrix(std::initializer_list<ElmType> values)
   {
-    return nCol;
+    assert(values.size() == kSize);
+    std::copy_n(values.begin(), kSize, data);
   }
 
-  Matrix<ElmType>
-  operator+(const Matrix<ElmType>& that) const
+  template<typename E>
+  FixedMatrix(const MatrixExpression<E>& that)
   {
-    return this->add(that);
+    assign(that.self());
   }
 
-  Matrix<ElmType>
-  operator-(const Matrix<ElmType>& that) const
+  template<typename E>
+  FixedMatrix<ElmType, kRow, kCol>&
+  operator=(const MatrixExpression<E>& that)
   {
-    return this->sub(that);
+    assign(that.self());
+    return *this;
   }
 
-  Matrix<ElmType>
-  operator*(const Matrix<ElmType>& that) const
+  static constexpr size_type
+  getNRow()
   {
-    return this->mul(that);
+    return kRow;
   }
 
-  Matrix<ElmType>
-  operator+=(const Matrix<ElmType>& that)
+  static constexpr size_type
+  getNCol()
   {
-    return this->add_(that);
+    return kCol;
   }
 
-  Matrix<ElmType>
-  operator-=(const Matrix<ElmType>& that)
+  void
+  fill(const ElmType& value)
+  {
+    for (size_type i = 0; i < kSize; i++) {
+      data[i] = value;
+    }
+  }
+
+  FixedMatrix<ElmType, kCol, kRow>
+  transpose() const
   {
-    return this->sub_(that);
+    FixedMatrix<ElmType, kCol, kRow> tMat;
+    for (size_type i = 0; i < kRow; i++) {
+      for (size_type j = 0; j < kCol; j++) {
+        tMat[j][i] = data[i * kCol + j];
+      }
+    }
+    return tMat;
   }
 
   Matrix<ElmType>
-  operator*=(const Matrix<ElmType>& that)
+  toMatrix() const
   {
-    return this->mul_(that);
+    return Matrix<ElmType>(*this);
+  }
+
+  ElmType&
+  at(size_type y, size_type x)
+  {
+    assert(y < kRow && x < kCol);
+    return data[y * kCol + x];
+  }
+
+  const ElmType&
+  at(size_type y, size_type x) const
+  {
+    assert(y < kRow && x < kCol);
+    return data[y * kCol + x];
   }
 
   ElmType*
+  operator[](size_type row)
+  {
+    return &data[row * kCol];
+  }
+
+  const ElmType*
   operator[](size_type row) const
   {
-    return &data[row * nCol];
+    return &data[row * kCol];
   }
 
-  Matrix<ElmType>&
-  operator=(const Matrix<ElmType>& that)
+  template<typename E>
+  FixedMatrix<ElmType, kRow, kCol>&
+  operator+=(const MatrixExpression<E>& that)
   {
-    nRow = that.nRow;
-    nCol = that.nCol;
-    data = new ElmType[nRow * nCol];
-    for (int i = 0; i < nRow; i++) {
-      for (int j = 0; j < nCol; j++) {
-        (*this)[i][j] = that[i][j];
-      }
-    }
+    assign(MatrixBinaryExpression<FixedMatrix<ElmType, kRow, kCol>, E, MatrixAddOp>(*this, that.self()));
     return *this;
   }
 
-  friend Matrix<ElmType>
-  operator*(const Matrix<ElmType>& this_, double n)
+  template<typename E>
+  FixedMatrix<ElmType, kRow, kCol>&
+  operator-=(const MatrixExpression<E>& that)
   {
-    return this_.mul(n);
+    assign(MatrixBinaryExpression<FixedMatrix<ElmType, kRow, kCol>, E, MatrixSubOp>(*this, that.self()));
+    return *this;
   }
 
-  friend Matrix<ElmType>
-  operator*(double n, const Matrix<ElmType>& this_)
+  FixedMatrix<ElmType, kRow, kCol>&
+  operator*=(const ElmType& that)
   {
-    return this_.mul(n);
+    for (size_type i = 0; i < kSize; i++) {
+      data[i] *= that;
+    }
+    return *this;
   }
 
-  friend Matrix<ElmType>
-  operator/(const Matrix<ElmType>& this_, double n)
+  FixedMatrix<ElmType, kRow, kCol>&
+  operator/=(const ElmType& that)
   {
-    return this_.div(n);
+    for (size_type i = 0; i < kSize; i++) {
+      data[i] /= that;
+    }
+    return *this;
   }
 
-  friend Matrix<ElmType>
-  operator*=(const Matrix<ElmType>& this_, double n)
+  void
+  eval(ElmType& v, size_type i) const
   {
-    return this_.mul_(n);
+    v = data[i];
   }
 
-  friend Matrix<ElmType>
-  operator/=(const Matrix<ElmType>& this_, double n)
+  template<typename V>
+  void
+  eval(V& v, size_type i) const
   {
-    return this_.div_(n);
+    std::memcpy(&v, &data[i], sizeof(V));
   }
 
   template<typename CharT, typename Traits>
   friend std::basic_ostream<CharT, Traits>&
-  operator<<(std::basic_ostream<CharT, Traits>& os, const Array2D<ElmType>& this_)
+  operator<<(std::basic_ostream<CharT, Traits>& os, const FixedMatrix<ElmType, kRow, kCol>& this_)
   {
     os << "{\n";
-    for (size_type i = 0; i < this_.nRow; i++) {
+    for (size_type i = 0; i < kRow; i++) {
       os << "  {";
-      for (size_type j = 0, jMax = this_.nCol - 1; j < jMax; j++) {
+      for (size_type j = 0; j < kCol - 1; j++) {
         os << this_[i][j] << ", ";
       }
-      os << this_[i][this_.nCol - 1] << "}\n";
+      os << this_[i][kCol - 1] << "}\n";
     }
     os << "}";
     return os;
   }
-};  // class Matrix
+
+private:
+  template<typename E>
+  void
+  assign(const E& e)
+  {
+    assert(e.getNRow() == kRow && e.getNCol() == kCol);
+    for (size_type i = 0; i < kSize; i++) {
+      e.eval(data[i], i);
+    }
+  }
+
+  alignas(kAlignment) ElmType data[kSize];
+};  // class FixedMatrix
+
+
+template<
+  typename ElmType,
+  std::size_t kRow,
+  std::size_t kCol
+>
+constexpr std::size_t FixedMatrix<ElmType, kRow, kCol>::kSize;
+
+
+/*!
+ * @brief Product of fixed size matrices, fully unrolled and kept on stack
+ */
+template<
+  typename ElmType,
+  std::size_t kRow,
+  std::size_t kMid,
+  std::size_t kCol
+>
+static inline FixedMatrix<ElmType, kRow, kCol>
+operator*(const FixedMatrix<ElmType, kRow, kMid>& lhs, const FixedMatrix<ElmType, kMid, kCol>& rhs)
+{
+  typedef MatrixKernelTraits<ElmType> Traits;
+
+  FixedMatrix<ElmType, kRow, kCol> result;
+  for (std::size_t i = 0; i < kRow; i++) {
+    for (std::size_t j = 0; j < kCol; j++) {
+      typename Traits::AccumulatorType p = typename Traits::AccumulatorType();
+      for (std::size_t k = 0; k < kMid; k++) {
+        Traits::madd(p, lhs[i][k], rhs[k][j]);
+        if (Traits::kReduceInterval != 0 && (k + 1) % Traits::kReduceInterval == 0) {
+          Traits::reduce(p);
+        }
+      }
+      result[i][j] = Traits::toElement(p);
+    }
+  }
+  return result;
+}
 
 
 #endif  // MATRIX_HPP
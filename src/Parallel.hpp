@@ -0,0 +1,70 @@
+/*!
+ * @file Parallel.hpp
+ * @brief Thread-count policy and chunked parallel loop shared by the parallel algorithms
+ * @author koturn
+ */
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+/*!
+ * @brief Policy to opt in to multi-threaded algorithms
+ */
+struct ParallelPolicy
+{
+  explicit ParallelPolicy(unsigned int nThreads_ = std::thread::hardware_concurrency())
+    : nThreads(nThreads_ == 0 ? 1 : nThreads_)
+  {}
+
+  //! Number of threads
+  unsigned int nThreads;
+};  // struct ParallelPolicy
+
+
+/*!
+ * @brief Run function for each chunk of [0, n) in parallel
+ *
+ * [0, n) is split into at most policy.nThreads contiguous chunks whose
+ * boundaries are multiples of unit (except n), and the calling thread
+ * runs the first chunk.
+ * Chunk boundaries depend only on n, unit and policy, so that successive
+ * calls can share per-chunk results indexed by chunk number.
+ *
+ * @tparam F  Function type which equivalent to std::function<void(unsigned int, std::size_t, std::size_t)>
+ * @param [in] n       Number of items
+ * @param [in] unit    Granularity of chunk boundaries
+ * @param [in] policy  Parallel policy
+ * @param [in] f       Function which receives chunk number and range [first, last)
+ */
+template<typename F>
+static inline void
+parallelForChunk(std::size_t n, std::size_t unit, const ParallelPolicy& policy, const F& f)
+{
+  const auto nUnits = (n + unit - 1) / unit;
+  const auto nChunks = std::max<std::size_t>(1, std::min<std::size_t>(policy.nThreads, nUnits));
+  if (nChunks == 1) {
+    f(0, 0, n);
+    return;
+  }
+  const auto chunkSize = (nUnits + nChunks - 1) / nChunks * unit;
+  std::vector<std::thread> threads;
+  threads.reserve(nChunks - 1);
+  for (unsigned int t = 1; t < nChunks; t++) {
+    const auto first = std::min(n, chunkSize * t);
+    const auto last = std::min(n, first + chunkSize);
+    threads.emplace_back([&f, t, first, last] {
+      f(t, first, last);
+    });
+  }
+  f(0, 0, std::min(n, chunkSize));
+  for (auto& th : threads) {
+    th.join();
+  }
+}
+
+
+#endif  // PARALLEL_HPP
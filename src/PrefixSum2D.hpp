@@ -0,0 +1,204 @@
+/*!
+ * @file PrefixSum2D.hpp
+ * @brief Rectangle sum queries over Array2D
+ * @author koturn
+ */
+#ifndef PREFIX_SUM_2D_HPP
+#define PREFIX_SUM_2D_HPP
+
+#include <cassert>
+#include <algorithm>
+
+#include "Array2D.hpp"
+
+
+/*!
+ * @brief Summed-area table for static rectangle sum queries
+ *
+ * Build is O(HW): each row is scanned, then the previous row of the table
+ * is added element-wise, which is a contiguous loop the compiler vectorizes.
+ * Queries are O(1).
+ *
+ * @tparam T  Type of element
+ */
+template<typename T>
+class SummedAreaTable
+{
+public:
+  typedef std::size_t size_type;
+
+  explicit SummedAreaTable(const Array2D<T>& arr)
+    : m_table(arr.getNRow() + 1, arr.getNCol() + 1, Array2D<T>::recommendedPitch(arr.getNCol() + 1))
+  {
+    const auto nRow = arr.getNRow();
+    const auto nCol = arr.getNCol();
+    std::fill_n(m_table[0], nCol + 1, T());
+    for (size_type i = 0; i < nRow; i++) {
+      const auto src = arr[i];
+      const auto prev = m_table[i];
+      const auto dst = m_table[i + 1];
+      auto sum = T();
+      dst[0] = T();
+      for (size_type j = 0; j < nCol; j++) {
+        sum += src[j];
+        dst[j + 1] = sum;
+      }
+      for (size_type j = 1; j <= nCol; j++) {
+        dst[j] += prev[j];
+      }
+    }
+  }
+
+  /*!
+   * @brief Sum of [0, y) x [0, x)
+   */
+  T
+  sum(size_type y, size_type x) const noexcept
+  {
+    return m_table.at(y, x);
+  }
+
+  /*!
+   * @brief Sum of rectangle [y1, y2) x [x1, x2)
+   * @param [in] y1  First row (inclusive)
+   * @param [in] x1  First column (inclusive)
+   * @param [in] y2  Last row (exclusive)
+   * @param [in] x2  Last column (exclusive)
+   * @return Sum of elements in the rectangle
+   */
+  T
+  rectSum(size_type y1, size_type x1, size_type y2, size_type x2) const noexcept
+  {
+    assert(y1 <= y2 && x1 <= x2);
+    return m_table[y2][x2] - m_table[y1][x2] - m_table[y2][x1] + m_table[y1][x1];
+  }
+
+  size_type
+  getNRow() const noexcept
+  {
+    return m_table.getNRow() - 1;
+  }
+
+  size_type
+  getNCol() const noexcept
+  {
+    return m_table.getNCol() - 1;
+  }
+
+private:
+  //! Prefix sums with a zero row and a zero column at the top-left
+  Array2D<T> m_table;
+};  // class SummedAreaTable
+
+
+/*!
+ * @brief Two-dimensional Fenwick tree (binary indexed tree)
+ *
+ * Point update and rectangle sum query are both O(log H log W).
+ *
+ * @tparam T  Type of element
+ */
+template<typename T>
+class FenwickTree2D
+{
+public:
+  typedef std::size_t size_type;
+
+  FenwickTree2D(size_type nRow, size_type nCol)
+    : m_tree(nRow + 1, nCol + 1, Array2D<T>::recommendedPitch(nCol + 1))
+  {
+    m_tree.fill(T());
+  }
+
+  /*!
+   * @brief Build from initial values in O(HW)
+   * @param [in] arr  Initial values
+   */
+  explicit FenwickTree2D(const Array2D<T>& arr)
+    : FenwickTree2D(arr.getNRow(), arr.getNCol())
+  {
+    const auto nRow = arr.getNRow();
+    const auto nCol = arr.getNCol();
+    for (size_type i = 1; i <= nRow; i++) {
+      const auto row = m_tree[i];
+      std::copy_n(arr[i - 1], nCol, row + 1);
+      for (size_type j = 1; j <= nCol; j++) {
+        const auto k = j + (j & (~j + 1));
+        if (k <= nCol) {
+          row[k] += row[j];
+        }
+      }
+    }
+    for (size_type i = 1; i <= nRow; i++) {
+      const auto k = i + (i & (~i + 1));
+      if (k <= nRow) {
+        const auto src = m_tree[i];
+        const auto dst = m_tree[k];
+        for (size_type j = 1; j <= nCol; j++) {
+          dst[j] += src[j];
+        }
+      }
+    }
+  }
+
+  /*!
+   * @brief Add value to element (y, x)
+   */
+  void
+  add(size_type y, size_type x, const T& value) noexcept
+  {
+    assert(y < getNRow() && x < getNCol());
+    for (auto i = y + 1; i <= getNRow(); i += i & (~i + 1)) {
+      const auto row = m_tree[i];
+      for (auto j = x + 1; j <= getNCol(); j += j & (~j + 1)) {
+        row[j] += value;
+      }
+    }
+  }
+
+  /*!
+   * @brief Sum of [0, y) x [0, x)
+   */
+  T
+  sum(size_type y, size_type x) const noexcept
+  {
+    assert(y <= getNRow() && x <= getNCol());
+    auto s = T();
+    for (auto i = y; i > 0; i &= i - 1) {
+      const auto row = m_tree[i];
+      for (auto j = x; j > 0; j &= j - 1) {
+        s += row[j];
+      }
+    }
+    return s;
+  }
+
+  /*!
+   * @brief Sum of rectangle [y1, y2) x [x1, x2)
+   */
+  T
+  rectSum(size_type y1, size_type x1, size_type y2, size_type x2) const noexcept
+  {
+    assert(y1 <= y2 && x1 <= x2);
+    return sum(y2, x2) - sum(y1, x2) - sum(y2, x1) + sum(y1, x1);
+  }
+
+  size_type
+  getNRow() const noexcept
+  {
+    return m_tree.getNRow() - 1;
+  }
+
+  size_type
+  getNCol() const noexcept
+  {
+    return m_tree.getNCol() - 1;
+  }
+
+private:
+  //! 1-indexed tree, row 0 and column 0 are unused
+  Array2D<T> m_tree;
+};  // class FenwickTree2D
+
+
+#endif  // PREFIX_SUM_2D_HPP
@@ -0,0 +1,443 @@
+/*!
+ * @file SparseMatrix.hpp
+ * @brief Sparse matrix in compressed sparse row (CSR) format
+ * @author koturn
+ */
+#ifndef SPARSE_MATRIX_HPP
+#define SPARSE_MATRIX_HPP
+
+#include <cassert>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Array2D.hpp"
+#include "Graph.hpp"
+#include "Matrix.hpp"
+#include "Parallel.hpp"
+
+
+/*!
+ * @brief Sparse matrix in CSR format
+ *
+ * Non-zero elements of row i are values()[rowPtr()[i] .. rowPtr()[i + 1])
+ * with column indices colIndex()[...] sorted in ascending order.
+ * The CSC form of A is the CSR form of A^T, which transpose() builds.
+ *
+ * Products with a dense vector or Matrix can be run in parallel with
+ * ParallelPolicy; rows are split so that each thread gets about the
+ * same number of non-zero elements.
+ *
+ * @tparam ElmType  Type of element
+ */
+template<typename ElmType>
+class SparseMatrix
+{
+public:
+  typedef std::size_t size_type;
+  typedef ElmType value_type;
+
+  SparseMatrix() noexcept
+    : m_nRow(0)
+    , m_nCol(0)
+    , m_rowPtr(1, 0)
+    , m_colIdx()
+    , m_values()
+  {}
+
+  /*!
+   * @brief Construct zero matrix
+   * @param [in] nRow  Number of rows
+   * @param [in] nCol  Number of columns
+   */
+  SparseMatrix(size_type nRow, size_type nCol)
+    : m_nRow(nRow)
+    , m_nCol(nCol)
+    , m_rowPtr(nRow + 1, 0)
+    , m_colIdx()
+    , m_values()
+  {}
+
+  /*!
+   * @brief Construct from non-zero elements of a dense matrix
+   * @param [in] mat  Dense matrix
+   */
+  explicit SparseMatrix(const Matrix<ElmType>& mat)
+    : SparseMatrix(mat.getNRow(), mat.getNCol())
+  {
+    fromDense(mat);
+  }
+
+  /*!
+   * @brief Construct from non-zero elements of a two-dimensional array
+   * @param [in] arr  Two-dimensional array
+   */
+  explicit SparseMatrix(const Array2D<ElmType>& arr)
+    : SparseMatrix(arr.getNRow(), arr.getNCol())
+  {
+    fromDense(arr);
+  }
+
+  /*!
+   * @brief Build from (row, column, value) triplets
+   *
+   * Triplets may be in any order; duplicated positions are summed.
+   *
+   * @tparam Iterator  Input iterator of std::tuple<size_type, size_type, ElmType>
+   * @param [in] nRow   Number of rows
+   * @param [in] nCol   Number of columns
+   * @param [in] first  Start of triplets
+   * @param [in] last   End of triplets
+   * @return Sparse matrix
+   */
+  template<typename Iterator>
+  static SparseMatrix<ElmType>
+  fromTriplets(size_type nRow, size_type nCol, Iterator first, Iterator last)
+  {
+    std::vector<std::tuple<size_type, size_type, ElmType>> triplets(first, last);
+    return build(nRow, nCol, triplets);
+  }
+
+  /*!
+   * @brief Build adjacency matrix of a graph
+   *
+   * Element (from, to) is the cost of the edge; parallel edges are summed.
+   * Undirected graphs should contain both directions, as BellmanFord::getGraph()
+   * does for edges added by addEdge().
+   *
+   * @tparam Iterator  Input iterator of Edge<T, U>
+   * @param [in] n      Number of nodes
+   * @param [in] first  Start of edges
+   * @param [in] last   End of edges
+   * @return n x n adjacency matrix
+   */
+  template<typename Iterator>
+  static SparseMatrix<ElmType>
+  fromEdges(size_type n, Iterator first, Iterator last)
+  {
+    std::vector<std::tuple<size_type, size_type, ElmType>> triplets;
+    for (; first != last; ++first) {
+      triplets.emplace_back(
+        static_cast<size_type>(first->from),
+        static_cast<size_type>(first->to),
+        static_cast<ElmType>(first->cost));
+    }
+    return build(n, n, triplets);
+  }
+
+  template<
+    typename T,
+    typename U
+  >
+  static SparseMatrix<ElmType>
+  fromEdges(size_type n, const std::vector<Edge<T, U>>& edges)
+  {
+    return fromEdges(n, edges.begin(), edges.end());
+  }
+
+  /*!
+   * @brief Build adjacency matrix of a graph given as adjacency list
+   *
+   * Accepts getGraph() of Dijkstra and the spanning tree solvers;
+   * element (from, to) is the cost of the edge and parallel edges are summed.
+   *
+   * @param [in] adjacency  Element i holds the edges from node i
+   * @return adjacency.size() x adjacency.size() adjacency matrix
+   */
+  template<
+    typename T,
+    typename U
+  >
+  static SparseMatrix<ElmType>
+  fromAdjacency(const std::vector<std::vector<Edge<T, U>>>& adjacency)
+  {
+    std::vector<std::tuple<size_type, size_type, ElmType>> triplets;
+    for (const auto& edges : adjacency) {
+      for (const auto& e : edges) {
+        triplets.emplace_back(
+          static_cast<size_type>(e.from),
+          static_cast<size_type>(e.to),
+          static_cast<ElmType>(e.cost));
+      }
+    }
+    return build(adjacency.size(), adjacency.size(), triplets);
+  }
+
+  /*!
+   * @brief Convert into edge list, each non-zero element (i, j) becomes edge i -> j
+   * @tparam T  Type of node number
+   * @return Edges in row-major order
+   */
+  template<typename T = int>
+  std::vector<Edge<T, ElmType>>
+  toEdges() const
+  {
+    std::vector<Edge<T, ElmType>> edges;
+    edges.reserve(getNNZ());
+    for (size_type i = 0; i < m_nRow; i++) {
+      for (auto k = m_rowPtr[i]; k < m_rowPtr[i + 1]; k++) {
+        edges.emplace_back(static_cast<T>(i), static_cast<T>(m_colIdx[k]), m_values[k]);
+      }
+    }
+    return edges;
+  }
+
+  Matrix<ElmType>
+  toMatrix() const
+  {
+    Matrix<ElmType> mat(m_nRow, m_nCol);
+    mat.fill(ElmType());
+    for (size_type i = 0; i < m_nRow; i++) {
+      for (auto k = m_rowPtr[i]; k < m_rowPtr[i + 1]; k++) {
+        mat[i][m_colIdx[k]] = m_values[k];
+      }
+    }
+    return mat;
+  }
+
+  /*!
+   * @brief Calculate transposed matrix, which is also the CSC form of this matrix
+   * @return Transposed matrix
+   */
+  SparseMatrix<ElmType>
+  transpose() const
+  {
+    SparseMatrix<ElmType> result(m_nCol, m_nRow);
+    for (auto j : m_colIdx) {
+      result.m_rowPtr[j + 1]++;
+    }
+    for (size_type j = 0; j < m_nCol; j++) {
+      result.m_rowPtr[j + 1] += result.m_rowPtr[j];
+    }
+    result.m_colIdx.resize(getNNZ());
+    result.m_values.resize(getNNZ());
+    std::vector<size_type> pos(result.m_rowPtr.begin(), result.m_rowPtr.end() - 1);
+    for (size_type i = 0; i < m_nRow; i++) {
+      for (auto k = m_rowPtr[i]; k < m_rowPtr[i + 1]; k++) {
+        const auto p = pos[m_colIdx[k]]++;
+        result.m_colIdx[p] = i;
+        result.m_values[p] = m_values[k];
+      }
+    }
+    return result;
+  }
+
+  /*!
+   * @brief Sparse matrix-vector product, y = A x
+   * @param [in] x  Dense vector (size must be getNCol())
+   * @return Dense vector of size getNRow()
+   */
+  std::vector<ElmType>
+  mul(const std::vector<ElmType>& x) const
+  {
+    return mul(x, ParallelPolicy(1));
+  }
+
+  std::vector<ElmType>
+  mul(const std::vector<ElmType>& x, const ParallelPolicy& policy) const
+  {
+    assert(x.size() == m_nCol);
+    std::vector<ElmType> y(m_nRow);
+    parallelRows(policy, [&](size_type first, size_type last) {
+      for (auto i = first; i < last; i++) {
+        auto sum = ElmType();
+        for (auto k = m_rowPtr[i]; k < m_rowPtr[i + 1]; k++) {
+          sum += m_values[k] * x[m_colIdx[k]];
+        }
+        y[i] = sum;
+      }
+    });
+    return y;
+  }
+
+  /*!
+   * @brief Sparse matrix-dense matrix product, C = A B
+   *
+   * Each non-zero a(i, k) scales row k of B into row i of C,
+   * so the inner loop is a contiguous axpy over the columns of B.
+   *
+   * @param [in] mat  Dense matrix (number of rows must be getNCol())
+   * @return Dense matrix of getNRow() x mat.getNCol()
+   */
+  Matrix<ElmType>
+  mul(const Matrix<ElmType>& mat) const
+  {
+    return mul(mat, ParallelPolicy(1));
+  }
+
+  Matrix<ElmType>
+  mul(const Matrix<ElmType>& mat, const ParallelPolicy& policy) const
+  {
+    assert(mat.getNRow() == m_nCol);
+    const auto n = mat.getNCol();
+    Matrix<ElmType> result(m_nRow, n);
+    parallelRows(policy, [&](size_type first, size_type last) {
+      for (auto i = first; i < last; i++) {
+        const auto c = result[i];
+        std::fill_n(c, n, ElmType());
+        for (auto k = m_rowPtr[i]; k < m_rowPtr[i + 1]; k++) {
+          const auto a = m_values[k];
+          const auto b = mat[m_colIdx[k]];
+          for (size_type j = 0; j < n; j++) {
+            c[j] += a * b[j];
+          }
+        }
+      }
+    });
+    return result;
+  }
+
+  /*!
+   * @brief Get element, O(log(number of non-zero elements in the row))
+   * @param [in] y  Row index
+   * @param [in] x  Column index
+   * @return Element at (y, x)
+   */
+  ElmType
+  at(size_type y, size_type x) const
+  {
+    assert(y < m_nRow && x < m_nCol);
+    const auto first = m_colIdx.begin() + static_cast<std::ptrdiff_t>(m_rowPtr[y]);
+    const auto last = m_colIdx.begin() + static_cast<std::ptrdiff_t>(m_rowPtr[y + 1]);
+    const auto itr = std::lower_bound(first, last, x);
+    return itr != last && *itr == x ? m_values[static_cast<size_type>(itr - m_colIdx.begin())] : ElmType();
+  }
+
+  size_type
+  getNRow() const noexcept
+  {
+    return m_nRow;
+  }
+
+  size_type
+  getNCol() const noexcept
+  {
+    return m_nCol;
+  }
+
+  //! Number of stored non-zero elements
+  size_type
+  getNNZ() const noexcept
+  {
+    return m_values.size();
+  }
+
+  const std::vector<size_type>&
+  rowPtr() const noexcept
+  {
+    return m_rowPtr;
+  }
+
+  const std::vector<size_type>&
+  colIndex() const noexcept
+  {
+    return m_colIdx;
+  }
+
+  const std::vector<ElmType>&
+  values() const noexcept
+  {
+    return m_values;
+  }
+
+  template<typename CharT, typename Traits>
+  friend std::basic_ostream<CharT, Traits>&
+  operator<<(std::basic_ostream<CharT, Traits>& os, const SparseMatrix<ElmType>& this_)
+  {
+    for (size_type i = 0; i < this_.m_nRow; i++) {
+      for (auto k = this_.m_rowPtr[i]; k < this_.m_rowPtr[i + 1]; k++) {
+        os << '(' << i << ", " << this_.m_colIdx[k] << "): " << this_.m_values[k] << '\n';
+      }
+    }
+    return os;
+  }
+
+private:
+  template<typename Dense>
+  void
+  fromDense(const Dense& mat)
+  {
+    for (size_type i = 0; i < m_nRow; i++) {
+      const auto row = mat[i];
+      for (size_type j = 0; j < m_nCol; j++) {
+        if (row[j] != ElmType()) {
+          m_colIdx.push_back(j);
+          m_values.push_back(row[j]);
+        }
+      }
+      m_rowPtr[i + 1] = m_values.size();
+    }
+  }
+
+  static SparseMatrix<ElmType>
+  build(size_type nRow, size_type nCol, std::vector<std::tuple<size_type, size_type, ElmType>>& triplets)
+  {
+    std::sort(triplets.begin(), triplets.end(), [](
+        const std::tuple<size_type, size_type, ElmType>& x,
+        const std::tuple<size_type, size_type, ElmType>& y) {
+      return std::get<0>(x) != std::get<0>(y) ? std::get<0>(x) < std::get<0>(y) : std::get<1>(x) < std::get<1>(y);
+    });
+    SparseMatrix<ElmType> result(nRow, nCol);
+    result.m_colIdx.reserve(triplets.size());
+    result.m_values.reserve(triplets.size());
+    for (size_type k = 0; k < triplets.size(); k++) {
+      const auto i = std::get<0>(triplets[k]);
+      const auto j = std::get<1>(triplets[k]);
+      assert(i < nRow && j < nCol);
+      if (k > 0 && i == std::get<0>(triplets[k - 1]) && j == std::get<1>(triplets[k - 1])) {
+        result.m_values.back() += std::get<2>(triplets[k]);
+        continue;
+      }
+      result.m_colIdx.push_back(j);
+      result.m_values.push_back(std::get<2>(triplets[k]));
+      result.m_rowPtr[i + 1]++;
+    }
+    for (size_type i = 0; i < nRow; i++) {
+      result.m_rowPtr[i + 1] += result.m_rowPtr[i];
+    }
+    return result;
+  }
+
+  /*!
+   * @brief Call f(first, last) for row ranges with balanced number of non-zero elements
+   * @tparam F  Function type which equivalent to std::function<void(size_type, size_type)>
+   * @param [in] policy  Parallel policy
+   * @param [in] f       Function which receives range of rows [first, last)
+   */
+  template<typename F>
+  void
+  parallelRows(const ParallelPolicy& policy, const F& f) const
+  {
+    const auto nParts = std::max<size_type>(1, std::min<size_type>(policy.nThreads, m_nRow));
+    const auto nnz = getNNZ();
+    std::vector<size_type> bounds(nParts + 1, m_nRow);
+    bounds[0] = 0;
+    for (size_type t = 1; t < nParts; t++) {
+      const auto target = nnz / nParts * t + nnz % nParts * t / nParts;
+      bounds[t] = static_cast<size_type>(std::upper_bound(m_rowPtr.begin(), m_rowPtr.end(), target) - m_rowPtr.begin()) - 1;
+      bounds[t] = std::min(m_nRow, std::max(bounds[t], bounds[t - 1]));
+    }
+    parallelForChunk(nParts, 1, policy, [&f, &bounds](unsigned int, size_type first, size_type last) {
+      for (auto t = first; t < last; t++) {
+        f(bounds[t], bounds[t + 1]);
+      }
+    });
+  }
+
+  //! Number of rows
+  size_type m_nRow;
+  //! Number of columns
+  size_type m_nCol;
+  //! Offset of the first non-zero element of each row (size is m_nRow + 1)
+  std::vector<size_type> m_rowPtr;
+  //! Column index of each non-zero element
+  std::vector<size_type> m_colIdx;
+  //! Value of each non-zero element
+  std::vector<ElmType> m_values;
+};  // class SparseMatrix
+
+
+#endif  // SPARSE_MATRIX_HPP
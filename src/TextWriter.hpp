@@ -0,0 +1,279 @@
+/*!
+ * @file TextWriter.hpp
+ * @brief Buffered text output of Array2D and Matrix
+ * @author koturn
+ */
+#ifndef TEXT_WRITER_HPP
+#define TEXT_WRITER_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#  include <charconv>
+#endif  // __cplusplus >= 201703L
+
+#include "Array2D.hpp"
+#include "Matrix.hpp"
+
+
+/*!
+ * @brief Text writer which formats values into its own buffer
+ *
+ * Integers and floating point numbers are formatted without std::ostream
+ * (std::to_chars in C++17, otherwise a hand-written loop; snprintf for
+ * floating point numbers) and the buffer is written to the stream only when
+ * it is full, so that a dump of millions of elements is a few large writes.
+ * Floating point numbers are written in round-trip precision, which is
+ * deliberately build dependent: 0.1 is "0.1" with std::to_chars and
+ * "0.10000000000000001" with the "%.*g" fallback.
+ * Other types are written with operator<< after flushing the buffer.
+ *
+ * A writer can be reused for many dumps to keep its buffer allocated.
+ */
+class TextWriter
+{
+public:
+  typedef std::size_t size_type;
+
+  //! Default buffer size in bytes
+  static constexpr size_type kDefaultBufferSize = 1 << 20;
+  //! Maximum number of characters of a formatted number
+  static constexpr size_type kMaxNumberLength = 64;
+
+  explicit TextWriter(std::ostream& os, size_type bufferSize = kDefaultBufferSize)
+    : m_os(os)
+    , m_buffer(std::max(bufferSize, kMaxNumberLength * 2))
+    , m_pos(0)
+  {}
+
+  TextWriter(const TextWriter&) = delete;
+
+  TextWriter&
+  operator=(const TextWriter&) = delete;
+
+  ~TextWriter()
+  {
+    flush();
+  }
+
+  void
+  flush()
+  {
+    if (m_pos != 0) {
+      m_os.write(m_buffer.data(), static_cast<std::streamsize>(m_pos));
+      m_pos = 0;
+    }
+  }
+
+  TextWriter&
+  put(char c)
+  {
+    reserve(1);
+    m_buffer[m_pos++] = c;
+    return *this;
+  }
+
+  TextWriter&
+  write(const char* s, size_type n)
+  {
+    if (n > m_buffer.size()) {
+      flush();
+      m_os.write(s, static_cast<std::streamsize>(n));
+      return *this;
+    }
+    reserve(n);
+    std::memcpy(m_buffer.data() + m_pos, s, n);
+    m_pos += n;
+    return *this;
+  }
+
+  TextWriter&
+  write(const char* s)
+  {
+    return write(s, std::strlen(s));
+  }
+
+  /*!
+   * @brief Write a value
+   * @param [in] value  Value to write
+   * @return Reference to this writer
+   */
+  template<typename T>
+  TextWriter&
+  write(const T& value)
+  {
+    writeValue(value, Category<T>());
+    return *this;
+  }
+
+private:
+  template<typename T>
+  using Category = std::integral_constant<int,
+    std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value ? 0
+    : std::is_same<T, bool>::value ? 1
+    : std::is_integral<T>::value ? 2
+    : std::is_floating_point<T>::value ? 3
+    : 4>;
+
+  void
+  reserve(size_type n)
+  {
+    if (m_pos + n > m_buffer.size()) {
+      flush();
+    }
+  }
+
+  template<typename T>
+  void
+  writeValue(const T& value, std::integral_constant<int, 0>)
+  {
+    put(static_cast<char>(value));
+  }
+
+  template<typename T>
+  void
+  writeValue(const T& value, std::integral_constant<int, 1>)
+  {
+    put(value ? '1' : '0');
+  }
+
+  template<typename T>
+  void
+  writeValue(const T& value, std::integral_constant<int, 2>)
+  {
+    reserve(kMaxNumberLength);
+    const auto first = m_buffer.data() + m_pos;
+#if __cplusplus >= 201703L
+    m_pos += static_cast<size_type>(std::to_chars(first, first + kMaxNumberLength, value).ptr - first);
+#else
+    typedef typename std::make_unsigned<T>::type U;
+    auto u = static_cast<U>(value);
+    auto p = first;
+    if (value < 0) {
+      *p++ = '-';
+      u = static_cast<U>(U(0) - u);
+    }
+    char digits[std::numeric_limits<U>::digits10 + 1];
+    auto q = digits;
+    do {
+      *q++ = static_cast<char>('0' + u % 10);
+      u /= 10;
+    } while (u != 0);
+    for (; q != digits; *p++ = *--q);
+    m_pos += static_cast<size_type>(p - first);
+#endif  // __cplusplus >= 201703L
+  }
+
+  template<typename T>
+  void
+  writeValue(const T& value, std::integral_constant<int, 3>)
+  {
+    reserve(kMaxNumberLength);
+    const auto first = m_buffer.data() + m_pos;
+#if __cplusplus >= 201703L && defined(__cpp_lib_to_chars)
+    m_pos += static_cast<size_type>(std::to_chars(first, first + kMaxNumberLength, value).ptr - first);
+#else
+    m_pos += static_cast<size_type>(formatFloat(first, std::numeric_limits<T>::max_digits10, value));
+#endif  // __cplusplus >= 201703L && defined(__cpp_lib_to_chars)
+  }
+
+#if __cplusplus < 201703L || !defined(__cpp_lib_to_chars)
+  static int
+  formatFloat(char* first, int precision, double value) noexcept
+  {
+    return std::snprintf(first, kMaxNumberLength, "%.*g", precision, value);
+  }
+
+  static int
+  formatFloat(char* first, int precision, long double value) noexcept
+  {
+    return std::snprintf(first, kMaxNumberLength, "%.*Lg", precision, value);
+  }
+#endif  // __cplusplus < 201703L || !defined(__cpp_lib_to_chars)
+
+  template<typename T>
+  void
+  writeValue(const T& value, std::integral_constant<int, 4>)
+  {
+    flush();
+    m_os << value;
+  }
+
+  //! Destination stream
+  std::ostream& m_os;
+  //! Buffer of formatted characters
+  std::vector<char> m_buffer;
+  //! Number of characters in the buffer
+  size_type m_pos;
+};  // class TextWriter
+
+
+/*!
+ * @brief Write elements in the same layout as operator<< of Array2D and Matrix
+ *
+ * Floating point elements are written in the format of TextWriter, which
+ * differs from operator<<.
+ *
+ * @tparam Container  Array2D or Matrix
+ * @param [in,out] writer     Text writer
+ * @param [in]     container  Array to write
+ */
+template<typename Container>
+static inline void
+writeTextRows(TextWriter& writer, const Container& container)
+{
+  writer.write("{\n", 2);
+  for (std::size_t i = 0; i < container.getNRow(); i++) {
+    writer.write("  {", 3);
+    for (std::size_t j = 0; j < container.getNCol(); j++) {
+      if (j != 0) {
+        writer.write(", ", 2);
+      }
+      writer.write(container.at(i, j));
+    }
+    writer.write("}\n", 2);
+  }
+  writer.put('}');
+}
+
+
+template<
+  typename T,
+  typename Layout
+>
+static inline void
+writeText(TextWriter& writer, const Array2D<T, Layout>& arr)
+{
+  writeTextRows(writer, arr);
+}
+
+
+template<typename T>
+static inline void
+writeText(TextWriter& writer, const Matrix<T>& mat)
+{
+  writeTextRows(writer, mat);
+}
+
+
+/*!
+ * @brief Write Array2D or Matrix as text with a temporary writer
+ * @param [out] os         Output stream
+ * @param [in]  container  Array2D or Matrix to write
+ */
+template<typename Container>
+static inline void
+writeText(std::ostream& os, const Container& container)
+{
+  TextWriter writer(os);
+  writeText(writer, container);
+}
+
+
+#endif  // TEXT_WRITER_HPP
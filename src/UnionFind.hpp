@@ -6,14 +6,25 @@
 #ifndef UNION_FIND_HPP
 #define UNION_FIND_HPP
 
+#include <cstdint>
 #include <cstdlib>
-#include <numeric>
+#include <atomic>
+#include <map>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 
 /*!
  * @brief Class of Union Find
+ *
+ * Parents and set sizes are packed into a single array;
+ * a negative value -s means that the node is a root of a set of size s.
+ * Memory usage is sizeof(T) bytes per node, and the number of nodes must
+ * not exceed the maximum of the signed type of T, because a root stores the
+ * negated set size; std::int16_t allows only 32767 nodes, so std::int32_t
+ * is the narrowest type for large instances (e.g. 2 GB for 500M nodes).
+ *
  * @tparam T  Type of node number (integer)
  */
 template<typename T = int>
@@ -21,56 +32,858 @@ class UnionFind
 {
   static_assert(std::is_integral<T>::value, "[UnionFind] Type of node must be an integer");
 
+private:
+  using S = typename std::make_signed<T>::type;
+
 public:
   /*!
    * @brief Ctor
    * @param [in] n  Number of node
    */
   UnionFind(T n) noexcept
+    : m_data(n, -1)
+  {}
+
+  /*!
+   * @brief Find root node with path halving
+   * @param [in] x  Node number to find
+   * @return node number
+   */
+  T
+  find(T x) noexcept
+  {
+    for (; m_data[x] >= 0; x = static_cast<T>(m_data[x])) {
+      const auto gp = m_data[m_data[x]];
+      if (gp >= 0) {
+        m_data[x] = gp;
+      }
+    }
+    return x;
+  }
+
+  /*!
+   * @brief Merge two groups (union by size)
+   *
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   * @return Return true if two groups are merged, false if they are already same group
+   */
+  bool
+  unite(T x, T y) noexcept
+  {
+    x = find(x);
+    y = find(y);
+    if (x == y) {
+      return false;
+    }
+    if (m_data[x] > m_data[y]) {
+      std::swap(x, y);
+    }
+    m_data[x] += m_data[y];
+    m_data[y] = static_cast<S>(x);
+    return true;
+  }
+
+  /*!
+   * @brief Identify whether two nodes are same group
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   * @return Return true if two nodes are same group, otherwise false
+   */
+  bool
+  isSame(T x, T y) noexcept
+  {
+    return find(x) == find(y);
+  }
+
+  /*!
+   * @brief Get size of the group which specified node belongs to
+   * @param [in] x  Node number
+   * @return Size of the group
+   */
+  T
+  size(T x) noexcept
+  {
+    return static_cast<T>(-m_data[find(x)]);
+  }
+
+  /*!
+   * @brief Merge groups of many node pairs
+   *
+   * Entries of pairs a few steps ahead are prefetched to hide memory latency
+   * of random access on large node arrays.
+   *
+   * @tparam Iterator  Iterator of std::pair<T, T>
+   * @param [in] first  Start of node pairs
+   * @param [in] last   End of node pairs
+   * @return Number of merged pairs
+   */
+  template<typename Iterator>
+  std::size_t
+  uniteBatch(Iterator first, Iterator last) noexcept
+  {
+    static constexpr int kPrefetchDistance = 8;
+
+    auto ahead = first;
+    for (int i = 0; i < kPrefetchDistance && ahead != last; i++, ++ahead) {
+      prefetch(ahead->first);
+      prefetch(ahead->second);
+    }
+    std::size_t cnt = 0;
+    for (; first != last; ++first) {
+      if (ahead != last) {
+        prefetch(ahead->first);
+        prefetch(ahead->second);
+        ++ahead;
+      }
+      if (unite(first->first, first->second)) {
+        cnt++;
+      }
+    }
+    return cnt;
+  }
+
+private:
+  /*!
+   * @brief Prefetch entry of specified node
+   * @param [in] x  Node number
+   */
+  void
+  prefetch(T x) const noexcept
+  {
+#if defined(__GNUC__)
+    __builtin_prefetch(&m_data[x], 1);
+#else
+    static_cast<void>(x);
+#endif  // defined(__GNUC__)
+  }
+
+  //! Parent node numbers, or negated group sizes for root nodes
+  std::vector<S> m_data;
+};  // class UnionFind
+
+
+
+/*!
+ * @brief Class of lock-free Union Find which supports concurrent unite() and isSame()
+ *
+ * Roots are linked with CAS and paths are compressed by path halving with CAS
+ * (Jayanti-Tarjan style).
+ * Linking order is decided by a hashed priority of node numbers, which behaves
+ * like randomized linking while being deterministic.
+ *
+ * @tparam T  Type of node number (integer)
+ */
+template<typename T = int>
+class ConcurrentUnionFind
+{
+  static_assert(std::is_integral<T>::value, "[ConcurrentUnionFind] Type of node must be an integer");
+
+public:
+  /*!
+   * @brief Ctor
+   * @param [in] n  Number of node
+   */
+  ConcurrentUnionFind(T n) noexcept
     : m_par(n)
-    , m_rank(n)
   {
-    std::iota(std::begin(m_par), std::end(m_par), 0);
+    for (T i = 0; i < n; i++) {
+      m_par[i].store(i, std::memory_order_relaxed);
+    }
   }
 
   /*!
-   * @brief Find node
+   * @brief Find root node with path halving
    * @param [in] x  Node number to find
    * @return node number
    */
   T
   find(T x) noexcept
   {
-    return m_par[x] == x ? x : (m_par[x] = find(m_par[x]));
+    for (;;) {
+      auto p = m_par[x].load(std::memory_order_acquire);
+      if (p == x) {
+        return x;
+      }
+      const auto gp = m_par[p].load(std::memory_order_acquire);
+      if (p != gp) {
+        // Failure means another thread already changed the parent, which is fine
+        m_par[x].compare_exchange_weak(p, gp, std::memory_order_release, std::memory_order_relaxed);
+      }
+      x = gp;
+    }
   }
 
   /*!
    * @brief Merge two groups
    *
-   * @param [in] x
-   * @param [in] y
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   * @return Return true if this call merged two groups, false if they are already same group
    */
-  void
+  bool
   unite(T x, T y) noexcept
+  {
+    for (;;) {
+      x = find(x);
+      y = find(y);
+      if (x == y) {
+        return false;
+      }
+      if (isPrior(x, y)) {
+        std::swap(x, y);
+      }
+      // Link x under y only if x is still a root
+      auto expected = x;
+      if (m_par[x].compare_exchange_strong(expected, y, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+
+  /*!
+   * @brief Identify whether two nodes are same group
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   * @return Return true if two nodes are same group, otherwise false
+   */
+  bool
+  isSame(T x, T y) noexcept
+  {
+    for (;;) {
+      x = find(x);
+      y = find(y);
+      if (x == y) {
+        return true;
+      }
+      // If x is still a root, x and y were different roots at this point
+      if (m_par[x].load(std::memory_order_acquire) == x) {
+        return false;
+      }
+    }
+  }
+
+private:
+  /*!
+   * @brief Identify whether root x has higher linking priority than root y
+   * @param [in] x  First root
+   * @param [in] y  Second root
+   * @return Return true if y should be linked under x
+   */
+  static bool
+  isPrior(T x, T y) noexcept
+  {
+    const auto hx = hash(x);
+    const auto hy = hash(y);
+    return hx > hy || (hx == hy && x > y);
+  }
+
+  /*!
+   * @brief Mix bits of node number (finalizer of MurmurHash3)
+   * @param [in] x  Node number
+   * @return Hashed value
+   */
+  static std::uint64_t
+  hash(T x) noexcept
+  {
+    auto h = static_cast<std::uint64_t>(x);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+  }
+
+  //! Parent node numbers
+  std::vector<std::atomic<T>> m_par;
+};  // class ConcurrentUnionFind
+
+
+
+/*!
+ * @brief Class of Union Find which can undo unions
+ *
+ * Union by size without path compression, so that find() is O(log n) and
+ * every union can be reverted with a history stack.
+ *
+ * @tparam T  Type of node number (integer)
+ */
+template<typename T = int>
+class RollbackUnionFind
+{
+  static_assert(std::is_integral<T>::value, "[RollbackUnionFind] Type of node must be an integer");
+
+private:
+  using S = typename std::make_signed<T>::type;
+
+public:
+  //! Type of history position returned by snapshot()
+  using size_type = std::size_t;
+
+  /*!
+   * @brief Ctor
+   * @param [in] n  Number of node
+   */
+  RollbackUnionFind(T n) noexcept
+    : m_data(n, -1)
+    , m_history()
+    , m_nGroups(n)
+  {}
+
+  /*!
+   * @brief Find root node
+   * @param [in] x  Node number to find
+   * @return node number
+   */
+  T
+  find(T x) const noexcept
+  {
+    for (; m_data[x] >= 0; x = static_cast<T>(m_data[x]));
+    return x;
+  }
+
+  /*!
+   * @brief Merge two groups (union by size)
+   *
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   * @return Return true if two groups are merged, false if they are already same group
+   */
+  bool
+  unite(T x, T y)
   {
     x = find(x);
     y = find(y);
     if (x == y) {
+      return false;
+    }
+    if (m_data[x] > m_data[y]) {
+      std::swap(x, y);
+    }
+    m_history.emplace_back(y, m_data[y]);
+    m_data[x] += m_data[y];
+    m_data[y] = static_cast<S>(x);
+    m_nGroups--;
+    return true;
+  }
+
+  /*!
+   * @brief Identify whether two nodes are same group
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   * @return Return true if two nodes are same group, otherwise false
+   */
+  bool
+  isSame(T x, T y) const noexcept
+  {
+    return find(x) == find(y);
+  }
+
+  /*!
+   * @brief Get size of the group which specified node belongs to
+   * @param [in] x  Node number
+   * @return Size of the group
+   */
+  T
+  size(T x) const noexcept
+  {
+    return static_cast<T>(-m_data[find(x)]);
+  }
+
+  /*!
+   * @brief Get number of groups
+   * @return Number of groups
+   */
+  T
+  countGroups() const noexcept
+  {
+    return m_nGroups;
+  }
+
+  /*!
+   * @brief Get current position of history
+   * @return Position which can be passed to rollback()
+   */
+  size_type
+  snapshot() const noexcept
+  {
+    return m_history.size();
+  }
+
+  /*!
+   * @brief Undo unions until the state of specified snapshot
+   * @param [in] to  Position obtained by snapshot()
+   */
+  void
+  rollback(size_type to) noexcept
+  {
+    while (m_history.size() > to) {
+      const auto& h = m_history.back();
+      const auto y = h.first;
+      const auto x = m_data[y];
+      m_data[x] -= h.second;
+      m_data[y] = h.second;
+      m_history.pop_back();
+      m_nGroups++;
+    }
+  }
+
+private:
+  //! Parent node numbers, or negated group sizes for root nodes
+  std::vector<S> m_data;
+  //! Pairs of linked root and its value before linking
+  std::vector<std::pair<T, S>> m_history;
+  //! Number of groups
+  T m_nGroups;
+};  // class RollbackUnionFind
+
+
+/*!
+ * @brief Offline dynamic connectivity solver
+ *
+ * Each edge is alive on an interval of query time, which is inserted into
+ * a segment tree over time.
+ * Traversing the segment tree with RollbackUnionFind answers every query in
+ * O(log^2 n) amortized.
+ *
+ * @tparam T  Type of node number (integer)
+ */
+template<typename T = int>
+class OfflineDynamicConnectivity
+{
+  static_assert(std::is_integral<T>::value, "[OfflineDynamicConnectivity] Type of node must be an integer");
+
+public:
+  /*!
+   * @brief Ctor
+   * @param [in] n  Number of node
+   */
+  OfflineDynamicConnectivity(T n) noexcept
+    : m_n(n)
+    , m_queries()
+    , m_openEdges()
+    , m_intervals()
+  {}
+
+  /*!
+   * @brief Insert an undirected edge at current time
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   */
+  void
+  addEdge(T x, T y)
+  {
+    m_openEdges[normalize(x, y)].push_back(m_queries.size());
+  }
+
+  /*!
+   * @brief Delete an undirected edge, which must be inserted before, at current time
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   */
+  void
+  removeEdge(T x, T y)
+  {
+    const auto key = normalize(x, y);
+    auto itr = m_openEdges.find(key);
+    if (itr == m_openEdges.end() || itr->second.empty()) {
       return;
     }
-    if (m_rank[x] < m_rank[y]) {
-      m_par[x] = y;
-    } else {
-      m_par[y] = x;
-      if (m_rank[x] == m_rank[y]) {
-        m_rank[x]++;
+    m_intervals.push_back(Interval{itr->second.back(), m_queries.size(), key.first, key.second});
+    itr->second.pop_back();
+    if (itr->second.empty()) {
+      m_openEdges.erase(itr);
+    }
+  }
+
+  /*!
+   * @brief Add a query whether two nodes are connected at current time
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   */
+  void
+  addQuery(T x, T y)
+  {
+    m_queries.emplace_back(x, y);
+  }
+
+  /*!
+   * @brief Answer all queries
+   * @return Answers of queries in the order of addQuery() calls
+   */
+  std::vector<bool>
+  solve() const
+  {
+    const auto nQuery = m_queries.size();
+    std::vector<bool> answers(nQuery);
+    if (nQuery == 0) {
+      return answers;
+    }
+
+    std::size_t size = 1;
+    for (; size < nQuery; size <<= 1);
+    std::vector<std::vector<std::pair<T, T>>> segTree(size * 2);
+    const auto insert = [&segTree, size](std::size_t l, std::size_t r, const std::pair<T, T>& e) {
+      for (l += size, r += size; l < r; l >>= 1, r >>= 1) {
+        if (l & 1) {
+          segTree[l++].push_back(e);
+        }
+        if (r & 1) {
+          segTree[--r].push_back(e);
+        }
+      }
+    };
+    for (const auto& iv : m_intervals) {
+      insert(iv.first, iv.last, std::make_pair(iv.x, iv.y));
+    }
+    for (const auto& kv : m_openEdges) {
+      for (const auto t : kv.second) {
+        insert(t, nQuery, kv.first);
       }
     }
+
+    RollbackUnionFind<T> uf(m_n);
+    dfs(segTree, uf, answers, 1, 0, size);
+    return answers;
+  }
+
+private:
+  /*!
+   * @brief Interval of time in which an edge is alive
+   */
+  struct Interval
+  {
+    //! Start time (inclusive)
+    std::size_t first;
+    //! End time (exclusive)
+    std::size_t last;
+    //! First node
+    T x;
+    //! Second node
+    T y;
+  };  // struct Interval
+
+  /*!
+   * @brief Traverse segment tree over time
+   * @param [in]     segTree  Edges of each node of segment tree
+   * @param [in,out] uf       Union Find
+   * @param [out]    answers  Answers of queries
+   * @param [in]     k        Index of segment tree node
+   * @param [in]     l        Start time of the node (inclusive)
+   * @param [in]     r        End time of the node (exclusive)
+   */
+  void
+  dfs(
+    const std::vector<std::vector<std::pair<T, T>>>& segTree,
+    RollbackUnionFind<T>& uf,
+    std::vector<bool>& answers,
+    std::size_t k,
+    std::size_t l,
+    std::size_t r) const
+  {
+    if (l >= m_queries.size()) {
+      return;
+    }
+    const auto snapshot = uf.snapshot();
+    for (const auto& e : segTree[k]) {
+      uf.unite(e.first, e.second);
+    }
+    if (r - l == 1) {
+      answers[l] = uf.isSame(m_queries[l].first, m_queries[l].second);
+    } else {
+      const auto m = (l + r) / 2;
+      dfs(segTree, uf, answers, k << 1, l, m);
+      dfs(segTree, uf, answers, k << 1 | 1, m, r);
+    }
+    uf.rollback(snapshot);
+  }
+
+  /*!
+   * @brief Make a key of undirected edge
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   * @return Pair of smaller and larger node
+   */
+  static std::pair<T, T>
+  normalize(T x, T y) noexcept
+  {
+    return x < y ? std::make_pair(x, y) : std::make_pair(y, x);
+  }
+
+  //! Number of node
+  T m_n;
+  //! Queries
+  std::vector<std::pair<T, T>> m_queries;
+  //! Insertion times of edges which are not deleted yet
+  std::map<std::pair<T, T>, std::vector<std::size_t>> m_openEdges;
+  //! Alive intervals of deleted edges
+  std::vector<Interval> m_intervals;
+};  // class OfflineDynamicConnectivity
+
+
+
+/*!
+ * @brief Abelian group of addition
+ * @tparam W  Type of value
+ */
+template<typename W = long long>
+struct AdditiveGroup
+{
+  //! Type of value
+  using value_type = W;
+
+  /*!
+   * @brief Identity element
+   * @return Identity element
+   */
+  static constexpr W
+  identity() noexcept
+  {
+    return W(0);
+  }
+
+  /*!
+   * @brief Group operation
+   * @param [in] a  First operand
+   * @param [in] b  Second operand
+   * @return Result of operation
+   */
+  static constexpr W
+  op(const W& a, const W& b) noexcept
+  {
+    return a + b;
+  }
+
+  /*!
+   * @brief Inverse element
+   * @param [in] a  An element
+   * @return Inverse element of a
+   */
+  static constexpr W
+  inverse(const W& a) noexcept
+  {
+    return -a;
+  }
+};  // struct AdditiveGroup
+
+
+/*!
+ * @brief Abelian group of exclusive or
+ * @tparam W  Type of value (integer)
+ */
+template<typename W = unsigned int>
+struct XorGroup
+{
+  static_assert(std::is_integral<W>::value, "[XorGroup] Type of value must be an integer");
+
+  //! Type of value
+  using value_type = W;
+
+  /*!
+   * @brief Identity element
+   * @return Identity element
+   */
+  static constexpr W
+  identity() noexcept
+  {
+    return W(0);
+  }
+
+  /*!
+   * @brief Group operation
+   * @param [in] a  First operand
+   * @param [in] b  Second operand
+   * @return Result of operation
+   */
+  static constexpr W
+  op(W a, W b) noexcept
+  {
+    return a ^ b;
+  }
+
+  /*!
+   * @brief Inverse element
+   * @param [in] a  An element
+   * @return Inverse element of a
+   */
+  static constexpr W
+  inverse(W a) noexcept
+  {
+    return a;
+  }
+};  // struct XorGroup
+
+
+/*!
+ * @brief Abelian group of addition modulo kMod
+ * @tparam W     Type of value (integer), values must be in [0, kMod)
+ * @tparam kMod  Modulus
+ */
+template<
+  typename W = long long,
+  W kMod = 1000000007
+>
+struct ModularAdditiveGroup
+{
+  static_assert(std::is_integral<W>::value, "[ModularAdditiveGroup] Type of value must be an integer");
+
+  //! Type of value
+  using value_type = W;
+
+  /*!
+   * @brief Identity element
+   * @return Identity element
+   */
+  static constexpr W
+  identity() noexcept
+  {
+    return W(0);
+  }
+
+  /*!
+   * @brief Group operation
+   * @param [in] a  First operand
+   * @param [in] b  Second operand
+   * @return Result of operation
+   */
+  static constexpr W
+  op(W a, W b) noexcept
+  {
+    return a + b >= kMod ? a + b - kMod : a + b;
+  }
+
+  /*!
+   * @brief Inverse element
+   * @param [in] a  An element
+   * @return Inverse element of a
+   */
+  static constexpr W
+  inverse(W a) noexcept
+  {
+    return a == 0 ? 0 : kMod - a;
+  }
+};  // struct ModularAdditiveGroup
+
+
+/*!
+ * @brief Class of weighted (potential) Union Find
+ *
+ * Each node has a potential relative to the root of its group,
+ * which is kept consistent under path compression.
+ * unite(x, y, w) means a constraint "potential(y) - potential(x) = w".
+ *
+ * @tparam T  Type of node number (integer)
+ * @tparam G  Abelian group type which provides value_type, identity(), op() and inverse()
+ */
+template<
+  typename T = int,
+  typename G = AdditiveGroup<>
+>
+class WeightedUnionFind
+{
+  static_assert(std::is_integral<T>::value, "[WeightedUnionFind] Type of node must be an integer");
+
+private:
+  using S = typename std::make_signed<T>::type;
+
+public:
+  //! Type of potential
+  using value_type = typename G::value_type;
+
+  /*!
+   * @brief Ctor
+   * @param [in] n  Number of node
+   */
+  WeightedUnionFind(T n)
+    : m_data(n, -1)
+    , m_weight(n, G::identity())
+  {}
+
+  /*!
+   * @brief Find root node with path compression
+   * @param [in] x  Node number to find
+   * @return node number
+   */
+  T
+  find(T x) noexcept
+  {
+    // First pass: find root and potential of x relative to the root
+    auto r = x;
+    auto w = G::identity();
+    for (; m_data[r] >= 0; r = static_cast<T>(m_data[r])) {
+      w = G::op(w, m_weight[r]);
+    }
+    // Second pass: link every node on the path directly to the root
+    while (m_data[x] >= 0) {
+      const auto p = static_cast<T>(m_data[x]);
+      const auto ow = m_weight[x];
+      m_data[x] = static_cast<S>(r);
+      m_weight[x] = w;
+      w = G::op(w, G::inverse(ow));
+      x = p;
+    }
+    return r;
+  }
+
+  /*!
+   * @brief Get potential of node relative to the root of its group
+   * @param [in] x  Node number
+   * @return Potential of x
+   */
+  value_type
+  weight(T x) noexcept
+  {
+    find(x);
+    return m_weight[x];
+  }
+
+  /*!
+   * @brief Get difference of potentials, potential(y) - potential(x)
+   *
+   * Two nodes must be in same group.
+   *
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   * @return potential(y) - potential(x)
+   */
+  value_type
+  diff(T x, T y) noexcept
+  {
+    return G::op(weight(y), G::inverse(weight(x)));
+  }
+
+  /*!
+   * @brief Merge two groups with a constraint "potential(y) - potential(x) = w"
+   *
+   * @param [in] x  First node
+   * @param [in] y  Second node
+   * @param [in] w  Difference of potentials
+   * @return Return false if the constraint conflicts with the existing constraints, otherwise true
+   */
+  bool
+  unite(T x, T y, value_type w) noexcept
+  {
+    // Make w the difference between the roots: potential(ry) - potential(rx)
+    w = G::op(G::op(w, weight(x)), G::inverse(weight(y)));
+    x = find(x);
+    y = find(y);
+    if (x == y) {
+      return w == G::identity();
+    }
+    if (m_data[x] > m_data[y]) {
+      std::swap(x, y);
+      w = G::inverse(w);
+    }
+    m_data[x] += m_data[y];
+    m_data[y] = static_cast<S>(x);
+    m_weight[y] = w;
+    return true;
   }
 
   /*!
    * @brief Identify whether two nodes are same group
-   * @param [in] x  First ndde
+   * @param [in] x  First node
    * @param [in] y  Second node
    * @return Return true if two nodes are same group, otherwise false
    */
@@ -80,12 +893,23 @@ public:
     return find(x) == find(y);
   }
 
+  /*!
+   * @brief Get size of the group which specified node belongs to
+   * @param [in] x  Node number
+   * @return Size of the group
+   */
+  T
+  size(T x) noexcept
+  {
+    return static_cast<T>(-m_data[find(x)]);
+  }
+
 private:
-  //! Node numbers
-  std::vector<T> m_par;
-  //! Node ranks
-  std::vector<int> m_rank;
-};  // class UnionFind
+  //! Parent node numbers, or negated group sizes for root nodes
+  std::vector<S> m_data;
+  //! Potentials relative to parent nodes
+  std::vector<value_type> m_weight;
+};  // class WeightedUnionFind
 
 
 #endif  // UNION_FIND_HPP